@@ -1,4 +1,23 @@
 #include "static_ptr.h"
+#include "huge_vector.h"
+#include "bulk_builder.h"
+#include "node_arena.h"
+#include "threaded_program.h"
+#include "poly_deque.h"
+#include "lru_cache.h"
+#include "sort_by_key.h"
+#include "static_error.h"
+#include "op_trace.h"
+#include "btree_map.h"
+#include <list>
+#include <map>
+#include <random>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <unordered_map>
+#include <variant>
 #include <vector>
 #include <iostream>
 #include <benchmark/benchmark.h>
@@ -39,6 +58,34 @@ public:
     }
 };
 
+// engines without a virtual destructor, so they are trivially destructible
+class ILightEngine {
+public:
+    ILightEngine(uint64_t& counter) : Counter_{&counter} {}
+    virtual void Do() = 0;
+
+protected:
+    ~ILightEngine() = default;
+
+    uint64_t* Counter_;
+};
+
+class TLightSteamEngine : public ILightEngine {
+public:
+    using ILightEngine::ILightEngine;
+    void Do() override {
+        ++*Counter_;
+    }
+};
+
+class TLightJetEngine : public ILightEngine {
+public:
+    using ILightEngine::ILightEngine;
+    void Do() override {
+        *Counter_ += 5;
+    }
+};
+
 template<typename SmartPtr>
 void BM_SingleSmartPointer(benchmark::State& state) {
     constexpr bool is_unique_ptr = std::is_same_v<std::unique_ptr<IEngine>, SmartPtr>;
@@ -119,12 +166,825 @@ void BM_IteratingOverSmartPointer(benchmark::State& state) {
     benchmark::DoNotOptimize(counter);
 }
 
+// emplace, move and reset a single pointer, alternating the types
+template<typename Base, typename First, typename Second>
+void BM_EmplaceResetChurn(benchmark::State& state) {
+    uint64_t counter = 0;
+    bool first = true;
+    sp::static_ptr<Base> ptr;
+    sp::static_ptr<Base> other;
+    for (auto _ : state) {
+        if (first) {
+            ptr.template emplace<First>(counter);
+        } else {
+            ptr.template emplace<Second>(counter);
+        }
+        first = !first;
+
+        other = std::move(ptr);
+        other->Do();
+        other.reset();
+
+        benchmark::DoNotOptimize(other.get());
+        benchmark::ClobberMemory();
+    }
+    benchmark::DoNotOptimize(counter);
+}
+
+template<typename Container>
+void FillContainer(Container& v, std::size_t size, uint64_t& counter) {
+    for (std::size_t i = 0; i < size; ++i) {
+        if (i % 3 == 0) {
+            v.emplace_back().template emplace<TSteamEngine>(counter);
+        } else if (i % 3 == 1) {
+            v.emplace_back().template emplace<TJetEngine>(counter);
+        } else {
+            v.emplace_back().template emplace<TSupersonicEngine>(counter);
+        }
+    }
+}
+
+template<typename Container>
+void BM_GrowingContainer(benchmark::State& state) {
+    const auto size = static_cast<std::size_t>(state.range(0));
+
+    uint64_t counter = 0;
+    for (auto _ : state) {
+        Container v;
+        FillContainer(v, size, counter);
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template<typename Container>
+void BM_IteratingOverContainer(benchmark::State& state) {
+    const auto size = static_cast<std::size_t>(state.range(0));
+
+    uint64_t counter = 0;
+    Container v;
+    FillContainer(v, size, counter);
+
+    for (auto _ : state) {
+        for (auto& ptr : v) {
+            ptr->Do();
+        }
+    }
+    benchmark::DoNotOptimize(counter);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// descriptor table of `size` engines, the payload is the counter
+sp::bulk_table_writer MakeEngineTable(std::size_t size, uint64_t& counter) {
+    sp::bulk_table_writer writer;
+    for (std::size_t i = 0; i < size; ++i) {
+        writer.add(static_cast<std::uint32_t>(i % 3), std::ref(counter));
+    }
+    return writer;
+}
+
+uint64_t& ReadCounter(std::span<const std::byte> payload) {
+    std::array<std::byte, sizeof(std::reference_wrapper<uint64_t>)> bytes;
+    std::memcpy(bytes.data(), payload.data(), bytes.size());
+    return std::bit_cast<std::reference_wrapper<uint64_t>>(bytes);
+}
+
+// a factory call per object and a move into the vector
+void BM_FactoryConstruction(benchmark::State& state) {
+    using TFactory = std::function<sp::static_ptr<IEngine>(std::span<const std::byte>)>;
+    const std::unordered_map<std::uint32_t, TFactory> factories{
+        {0, [](auto payload) { return sp::make_static<TSteamEngine>(ReadCounter(payload)); }},
+        {1, [](auto payload) { return sp::make_static<TJetEngine>(ReadCounter(payload)); }},
+        {2, [](auto payload) { return sp::make_static<TSupersonicEngine>(ReadCounter(payload)); }},
+    };
+
+    const auto size = static_cast<std::size_t>(state.range(0));
+    uint64_t counter = 0;
+    const auto table = MakeEngineTable(size, counter);
+    for (auto _ : state) {
+        std::vector<sp::static_ptr<IEngine>> v;
+        std::size_t pos = 0;
+        while (pos < table.data().size()) {
+            sp::bulk_record_header header;
+            std::memcpy(&header, table.data().data() + pos, sizeof(header));
+            pos += sizeof(header);
+            v.push_back(factories.at(header.type_id)(table.data().subspan(pos, header.size)));
+            pos += header.size;
+        }
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_BulkConstruction(benchmark::State& state) {
+    using TPayload = std::reference_wrapper<uint64_t>;
+    sp::bulk_builder<IEngine> builder;
+    builder.register_type<TSteamEngine, TPayload>(0);
+    builder.register_type<TJetEngine, TPayload>(1);
+    builder.register_type<TSupersonicEngine, TPayload>(2);
+
+    const auto size = static_cast<std::size_t>(state.range(0));
+    const auto threads = static_cast<std::size_t>(state.range(1));
+    uint64_t counter = 0;
+    const auto table = MakeEngineTable(size, counter);
+    for (auto _ : state) {
+        std::vector<sp::static_ptr<IEngine>> v;
+        builder.build(table.data(), v, {.threads = threads});
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// parent of each node of a random tree, parents precede their children
+std::vector<std::uint32_t> RandomTree(std::size_t size) {
+    std::mt19937 rng{42};
+    std::vector<std::uint32_t> parents(size, sp::node_arena<IEngine>::no_parent());
+    for (std::size_t i = 1; i < size; ++i) {
+        parents[i] = std::uniform_int_distribution<std::uint32_t>{0, static_cast<std::uint32_t>(i - 1)}(rng);
+    }
+    return parents;
+}
+
+void EmplaceEngine(sp::static_ptr<IEngine>& ptr, std::size_t i, uint64_t& counter) {
+    if (i % 3 == 0) {
+        ptr.emplace<TSteamEngine>(counter);
+    } else if (i % 3 == 1) {
+        ptr.emplace<TJetEngine>(counter);
+    } else {
+        ptr.emplace<TSupersonicEngine>(counter);
+    }
+}
+
+struct TEngineNode {
+    std::unique_ptr<IEngine> Engine;
+    std::vector<std::unique_ptr<TEngineNode>> Children;
+};
+
+void Traverse(const TEngineNode& node) {
+    node.Engine->Do();
+    for (const auto& child : node.Children) {
+        Traverse(*child);
+    }
+}
+
+void BM_TreeTraversal_UniquePtr(benchmark::State& state) {
+    const auto parents = RandomTree(static_cast<std::size_t>(state.range(0)));
+    uint64_t counter = 0;
+    std::vector<TEngineNode*> nodes;
+    std::unique_ptr<TEngineNode> root;
+    for (std::size_t i = 0; i < parents.size(); ++i) {
+        auto node = std::make_unique<TEngineNode>();
+        if (i % 3 == 0) {
+            node->Engine = std::make_unique<TSteamEngine>(counter);
+        } else if (i % 3 == 1) {
+            node->Engine = std::make_unique<TJetEngine>(counter);
+        } else {
+            node->Engine = std::make_unique<TSupersonicEngine>(counter);
+        }
+        nodes.push_back(node.get());
+        if (i == 0) {
+            root = std::move(node);
+        } else {
+            nodes[parents[i]]->Children.push_back(std::move(node));
+        }
+    }
+
+    for (auto _ : state) {
+        Traverse(*root);
+    }
+    benchmark::DoNotOptimize(counter);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_TreeTraversal_NodeArena(benchmark::State& state) {
+    const auto parents = RandomTree(static_cast<std::size_t>(state.range(0)));
+    uint64_t counter = 0;
+    sp::node_arena<IEngine> arena;
+    arena.build(parents, [&](auto& ptr, std::size_t i) { EmplaceEngine(ptr, i, counter); });
+    arena.relayout();
+
+    for (auto _ : state) {
+        arena.for_each_depth_first([&](auto h) { arena[h].Do(); });
+    }
+    benchmark::DoNotOptimize(counter);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+struct TEvalStack {
+    int64_t Values[64];
+    std::size_t Size = 0;
+
+    void Push(int64_t value) { Values[Size++] = value; }
+    int64_t Pop() { return Values[--Size]; }
+};
+
+class IOp {
+public:
+    virtual ~IOp() = default;
+    virtual void eval(TEvalStack& stack) const = 0;
+};
+
+class TPushOp : public IOp {
+public:
+    TPushOp(int64_t value) : Value_{value} {}
+    void eval(TEvalStack& stack) const override { stack.Push(Value_); }
+
+private:
+    int64_t Value_;
+};
+
+class TAddOp : public IOp {
+public:
+    void eval(TEvalStack& stack) const override { stack.Push(stack.Pop() + stack.Pop()); }
+};
+
+class TMulOp : public IOp {
+public:
+    void eval(TEvalStack& stack) const override { stack.Push(stack.Pop() * stack.Pop()); }
+};
+
+// ((1 + v) * v + v) * ... with a push before each binary op
+std::vector<sp::static_ptr<IOp>> MakeExpression() {
+    std::vector<sp::static_ptr<IOp>> ops;
+    ops.emplace_back().emplace<TPushOp>(1);
+    for (int64_t i = 0; i < 64; ++i) {
+        ops.emplace_back().emplace<TPushOp>(i);
+        if (i % 2) {
+            ops.emplace_back().emplace<TMulOp>();
+        } else {
+            ops.emplace_back().emplace<TAddOp>();
+        }
+    }
+    return ops;
+}
+
+void BM_Interpreter_Virtual(benchmark::State& state) {
+    const auto ops = MakeExpression();
+    for (auto _ : state) {
+        TEvalStack stack;
+        for (const auto& op : ops) {
+            op->eval(stack);
+        }
+        benchmark::DoNotOptimize(stack.Pop());
+    }
+    state.SetItemsProcessed(state.iterations() * ops.size());
+}
+
+// the baseline with a closed set of instructions
+void BM_Interpreter_Switch(benchmark::State& state) {
+    enum class EOp { Push, Add, Mul };
+    struct TInstruction {
+        EOp Op;
+        int64_t Value;
+    };
+    std::vector<TInstruction> code{{EOp::Push, 1}};
+    for (int64_t i = 0; i < 64; ++i) {
+        code.push_back({EOp::Push, i});
+        code.push_back({i % 2 ? EOp::Mul : EOp::Add, 0});
+    }
+
+    for (auto _ : state) {
+        TEvalStack stack;
+        for (const auto& ins : code) {
+            switch (ins.Op) {
+            case EOp::Push:
+                stack.Push(ins.Value);
+                break;
+            case EOp::Add:
+                stack.Push(stack.Pop() + stack.Pop());
+                break;
+            case EOp::Mul:
+                stack.Push(stack.Pop() * stack.Pop());
+                break;
+            }
+        }
+        benchmark::DoNotOptimize(stack.Pop());
+    }
+    state.SetItemsProcessed(state.iterations() * code.size());
+}
+
+template<bool Fuse>
+void BM_Interpreter_Threaded(benchmark::State& state) {
+    sp::threaded_compiler<IOp, TEvalStack> compiler;
+    compiler.register_op<TPushOp>();
+    compiler.register_op<TAddOp>();
+    compiler.register_op<TMulOp>();
+    if constexpr (Fuse) {
+        compiler.register_pair<TPushOp, TAddOp>();
+        compiler.register_pair<TPushOp, TMulOp>();
+    }
+    const auto program = compiler.compile(MakeExpression());
+
+    for (auto _ : state) {
+        TEvalStack stack;
+        program.run(stack);
+        benchmark::DoNotOptimize(stack.Pop());
+    }
+    state.SetItemsProcessed(state.iterations() * program.instruction_count());
+}
+
+void FillPolyDeque(sp::poly_deque<IEngine>& v, std::size_t size, uint64_t& counter) {
+    for (std::size_t i = 0; i < size; ++i) {
+        if (i % 3 == 0) {
+            v.emplace_back<TSteamEngine>(counter);
+        } else if (i % 3 == 1) {
+            v.emplace_back<TJetEngine>(counter);
+        } else {
+            v.emplace_back<TSupersonicEngine>(counter);
+        }
+    }
+}
+
+void BM_GrowingPolyDeque(benchmark::State& state) {
+    const auto size = static_cast<std::size_t>(state.range(0));
+
+    uint64_t counter = 0;
+    for (auto _ : state) {
+        sp::poly_deque<IEngine> v;
+        FillPolyDeque(v, size, counter);
+        benchmark::DoNotOptimize(&v.back());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_IteratingOverPolyDeque(benchmark::State& state) {
+    const auto size = static_cast<std::size_t>(state.range(0));
+
+    uint64_t counter = 0;
+    sp::poly_deque<IEngine> v;
+    FillPolyDeque(v, size, counter);
+
+    for (auto _ : state) {
+        v.for_each([](IEngine& engine) { engine.Do(); });
+    }
+    benchmark::DoNotOptimize(counter);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// LRU on top of the standard containers, allocating per insert
+class TStdLruCache {
+public:
+    explicit TStdLruCache(std::size_t capacity) : Capacity_{capacity} {}
+
+    template<typename Engine>
+    void Emplace(uint64_t key, uint64_t& counter) {
+        if (auto it = Index_.find(key); it != Index_.end()) {
+            Order_.erase(it->second);
+            Index_.erase(it);
+        }
+        if (Order_.size() == Capacity_) {
+            Index_.erase(Order_.back().first);
+            Order_.pop_back();
+        }
+        Order_.emplace_front(key, std::make_unique<Engine>(counter));
+        Index_[key] = Order_.begin();
+    }
+
+    IEngine* Get(uint64_t key) {
+        const auto it = Index_.find(key);
+        if (it == Index_.end()) {
+            return nullptr;
+        }
+        Order_.splice(Order_.begin(), Order_, it->second);
+        return it->second->second.get();
+    }
+
+private:
+    using TEntry = std::pair<uint64_t, std::unique_ptr<IEngine>>;
+
+    std::size_t Capacity_;
+    std::list<TEntry> Order_;
+    std::unordered_map<uint64_t, std::list<TEntry>::iterator> Index_;
+};
+
+// lookups of random keys, a miss computes and inserts the value
+template<typename Cache>
+void BM_LruCache(benchmark::State& state) {
+    constexpr std::size_t capacity = 1 << 14;
+    Cache cache(capacity);
+    std::mt19937_64 rng{42};
+    uint64_t counter = 0;
+    for (auto _ : state) {
+        const uint64_t key = rng() % (4 * capacity);
+        if constexpr (std::is_same_v<Cache, TStdLruCache>) {
+            if (auto* engine = cache.Get(key)) {
+                engine->Do();
+            } else {
+                cache.template Emplace<TJetEngine>(key, counter);
+            }
+        } else {
+            if (auto* engine = cache.get(key)) {
+                engine->Do();
+            } else {
+                cache.template emplace<TJetEngine>(key, counter);
+            }
+        }
+    }
+    benchmark::DoNotOptimize(counter);
+}
+
+class ITask {
+public:
+    virtual ~ITask() = default;
+    virtual int64_t Priority() const = 0;
+};
+
+class TFixedTask : public ITask {
+public:
+    TFixedTask(int64_t priority) : Priority_{priority} {}
+    int64_t Priority() const override { return Priority_; }
+
+private:
+    int64_t Priority_;
+};
+
+class TScaledTask : public ITask {
+public:
+    TScaledTask(int64_t priority) : Priority_{priority} {}
+    int64_t Priority() const override { return Priority_ * 2; }
+
+private:
+    int64_t Priority_;
+};
+
+// `BySortKey` extracts the keys once, otherwise every comparison makes two virtual calls
+template<bool BySortKey>
+void BM_SortByVirtualKey(benchmark::State& state) {
+    const auto size = state.range(0);
+    std::mt19937_64 rng{42};
+    std::vector<int64_t> priorities(size);
+    for (auto& priority : priorities) {
+        priority = static_cast<int64_t>(rng() % (1 << 20));
+    }
+    std::vector<sp::static_ptr<ITask>> tasks;
+    tasks.reserve(size);
+    for (auto _ : state) {
+        state.PauseTiming();
+        tasks.clear();
+        for (int64_t i = 0; i < size; ++i) {
+            if (i % 2) {
+                tasks.emplace_back().emplace<TFixedTask>(priorities[i]);
+            } else {
+                tasks.emplace_back().emplace<TScaledTask>(priorities[i]);
+            }
+        }
+        state.ResumeTiming();
+        if constexpr (BySortKey) {
+            sp::sort_by_key(tasks, [](const ITask& task) { return task.Priority(); });
+        } else {
+            std::stable_sort(tasks.begin(), tasks.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs->Priority() < rhs->Priority();
+            });
+        }
+        benchmark::DoNotOptimize(tasks.data());
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+class IErrorDetail {
+public:
+    virtual ~IErrorDetail() = default;
+    virtual std::string Message() const = 0;
+};
+
+struct TPriceReject : IErrorDetail {
+    TPriceReject(int64_t price, int64_t limit) : Price{price}, Limit{limit} {}
+    std::string Message() const override { return "price"; }
+    std::string message() const { return Message(); }
+
+    int64_t Price;
+    int64_t Limit;
+};
+
+struct TQuantityReject : IErrorDetail {
+    TQuantityReject(int64_t quantity) : Quantity{quantity} {}
+    std::string Message() const override { return "quantity"; }
+    std::string message() const { return Message(); }
+
+    int64_t Quantity;
+};
+
+using THeapResult = std::variant<int64_t, std::unique_ptr<IErrorDetail>>;
+using TStaticResult = std::variant<int64_t, sp::static_error<>>;
+
+template<typename Result>
+[[gnu::noinline]] Result CheckOrder(int64_t price, int64_t quantity) {
+    auto reject = [](auto detail) -> Result {
+        if constexpr (std::is_same_v<Result, THeapResult>) {
+            return std::make_unique<decltype(detail)>(detail);
+        } else {
+            return sp::make_error<decltype(detail)>(detail);
+        }
+    };
+    if (price > 900) {
+        return reject(TPriceReject{price, 900});
+    }
+    if (quantity > 500) {
+        return reject(TQuantityReject{quantity});
+    }
+    return price * quantity;
+}
+
+// half of the orders are rejected
+template<typename Result>
+void BM_OrderRejects(benchmark::State& state) {
+    std::mt19937_64 rng{42};
+    std::vector<std::pair<int64_t, int64_t>> orders(1 << 12);
+    for (auto& [price, quantity] : orders) {
+        price = static_cast<int64_t>(rng() % 1200);
+        quantity = static_cast<int64_t>(rng() % 800);
+    }
+    int64_t total = 0;
+    int64_t price_rejects = 0;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto& [price, quantity] = orders[i++ % orders.size()];
+        Result result = CheckOrder<Result>(price, quantity);
+        if (result.index() == 0) {
+            total += std::get<0>(result);
+        } else if constexpr (std::is_same_v<Result, THeapResult>) {
+            price_rejects += dynamic_cast<TPriceReject*>(std::get<1>(result).get()) != nullptr;
+        } else {
+            price_rejects += std::get<1>(result).template holds<TPriceReject>();
+        }
+    }
+    benchmark::DoNotOptimize(total);
+    benchmark::DoNotOptimize(price_rejects);
+}
+
+// replay of a trace recorded with STATIC_PTR_TRACE
+// each recorded type is replaced by an object of the same size class
+// (16 to 128 bytes, larger types are clamped) and one of four vtables
+class IReplay {
+public:
+    virtual ~IReplay() = default;
+    virtual void Do(uint64_t& counter) = 0;
+};
+
+template<std::size_t Size, int Variant>
+class TReplayObject : public IReplay {
+public:
+    void Do(uint64_t& counter) override {
+        counter += Variant + Payload_[0];
+    }
+
+private:
+    char Payload_[Size - sizeof(void*)] = {};
+};
+
+constexpr std::size_t ReplaySizeClasses = 4;
+constexpr std::size_t ReplayVariants = 4;
+
+template<typename Slot, std::size_t Size, int Variant>
+void EmplaceReplayObject(Slot& slot) {
+    using T = TReplayObject<Size, Variant>;
+    if constexpr (std::is_same_v<Slot, std::unique_ptr<IReplay>>) {
+        slot = std::make_unique<T>();
+    } else {
+        slot.template emplace<T>();
+    }
+}
+
+template<typename Slot, std::size_t ...I>
+constexpr auto MakeReplayEmplacers(std::index_sequence<I...>) {
+    using emplace_func = void(*)(Slot&);
+    return std::array<emplace_func, sizeof...(I)>{
+        &EmplaceReplayObject<Slot, (16 << (I / ReplayVariants)), static_cast<int>(I % ReplayVariants)>...
+    };
+}
+
+// index of the replay object of the recorded type
+std::size_t ReplayObjectIndex(const sp::trace_type& type, std::size_t id) {
+    std::size_t size_class = 0;
+    while (size_class + 1 < ReplaySizeClasses && (16u << size_class) < type.size) {
+        ++size_class;
+    }
+    return size_class * ReplayVariants + id % ReplayVariants;
+}
+
+// synthetic trace used when STATIC_PTR_REPLAY_TRACE doesn't name a recorded one
+// a skewed mix of types over a large set of pointers, dominated by dispatches
+sp::op_trace MakeSyntheticTrace() {
+    constexpr uint32_t slots = 1 << 16;
+    constexpr std::size_t records = 1 << 20;
+    sp::op_trace trace;
+    trace.slots = slots;
+    for (uint32_t size : {16, 24, 32, 48, 64, 96, 128, 16}) {
+        trace.types.push_back({size, "synthetic"});
+    }
+    std::mt19937 rng{42};
+    std::vector<bool> occupied(slots);
+    auto pick = [&] { return static_cast<uint32_t>(rng() % slots); };
+    while (trace.records.size() < records) {
+        const uint32_t slot = pick();
+        const uint32_t dice = rng() % 100;
+        if (!occupied[slot] || dice < 10) {
+            // lower types are more frequent
+            const auto type = static_cast<uint16_t>(std::min(rng() % 8, rng() % 8));
+            if (occupied[slot]) {
+                trace.records.push_back({slot, 0, 0, sp::trace_op::reset});
+            }
+            trace.records.push_back({slot, 0, type, sp::trace_op::emplace});
+            occupied[slot] = true;
+        } else if (dice < 20) {
+            const uint32_t dst = pick();
+            trace.records.push_back({dst, slot, 0, sp::trace_op::move});
+            occupied[dst] = true;
+            occupied[slot] = false;
+        } else if (dice < 25) {
+            trace.records.push_back({slot, 0, 0, sp::trace_op::reset});
+            occupied[slot] = false;
+        } else {
+            trace.records.push_back({slot, 0, 0, sp::trace_op::dispatch});
+        }
+    }
+    return trace;
+}
+
+const sp::op_trace& ReplayTrace() {
+    static const sp::op_trace trace = [] {
+        if (const char* path = std::getenv("STATIC_PTR_REPLAY_TRACE")) {
+            std::ifstream in{path, std::ios::binary};
+            return sp::op_trace::read(in);
+        }
+        return MakeSyntheticTrace();
+    }();
+    return trace;
+}
+
+// `Slots` is a container of the pointers, indexed by the trace slots
+template<typename Slots>
+void BM_TraceReplay(benchmark::State& state) {
+    using Slot = std::remove_reference_t<decltype(std::declval<Slots&>()[0])>;
+    static constexpr auto emplacers = MakeReplayEmplacers<Slot>(std::make_index_sequence<ReplaySizeClasses * ReplayVariants>{});
+
+    const sp::op_trace& trace = ReplayTrace();
+    std::vector<std::size_t> objects;
+    for (std::size_t i = 0; i < trace.types.size(); ++i) {
+        objects.push_back(ReplayObjectIndex(trace.types[i], i));
+    }
+    Slots slots;
+    for (uint32_t i = 0; i < trace.slots; ++i) {
+        slots.emplace_back();
+    }
+
+    uint64_t counter = 0;
+    for (auto _ : state) {
+        for (const auto& record : trace.records) {
+            Slot& slot = slots[record.slot];
+            switch (record.op) {
+            case sp::trace_op::emplace:
+                emplacers[objects[record.type]](slot);
+                break;
+            case sp::trace_op::move:
+                if (record.slot != record.source) {
+                    slot = std::move(slots[record.source]);
+                }
+                break;
+            case sp::trace_op::dispatch:
+                if (slot) {
+                    slot->Do(counter);
+                }
+                break;
+            case sp::trace_op::reset:
+                slot.reset();
+                break;
+            }
+        }
+        for (auto& slot : slots) {
+            slot.reset();
+        }
+    }
+    benchmark::DoNotOptimize(counter);
+    state.SetItemsProcessed(state.iterations() * trace.records.size());
+}
+
+// order book on std::map, allocating a node and a level per insert
+class TStdOrderBook {
+public:
+    template<typename Engine>
+    void Emplace(int64_t price, uint64_t& counter) {
+        Levels_[price] = std::make_unique<Engine>(counter);
+    }
+
+    IEngine* Get(int64_t price) {
+        const auto it = Levels_.find(price);
+        return it == Levels_.end() ? nullptr : it->second.get();
+    }
+
+    void Erase(int64_t price) {
+        Levels_.erase(price);
+    }
+
+    // the `count` levels from `price` on
+    void Sweep(int64_t price, int count) {
+        for (auto it = Levels_.lower_bound(price); it != Levels_.end() && count-- > 0; ++it) {
+            it->second->Do();
+        }
+    }
+
+private:
+    std::map<int64_t, std::unique_ptr<IEngine>> Levels_;
+};
+
+// half of the prices have a level, the operations are mostly lookups
+template<typename Book>
+void BM_OrderBook(benchmark::State& state) {
+    const auto levels = state.range(0);
+    Book book;
+    std::mt19937_64 rng{42};
+    uint64_t counter = 0;
+    auto price = [&] { return static_cast<int64_t>(rng() % (2 * levels)); };
+
+    auto emplace = [&](int64_t p) {
+        if constexpr (std::is_same_v<Book, TStdOrderBook>) {
+            book.template Emplace<TJetEngine>(p, counter);
+        } else {
+            book.template emplace<TJetEngine>(p, counter);
+        }
+    };
+    for (int64_t i = 0; i < levels; ++i) {
+        emplace(price());
+    }
+
+    for (auto _ : state) {
+        const int64_t p = price();
+        const auto op = rng() % 8;
+        if (op == 0) {
+            emplace(p);
+        } else if constexpr (std::is_same_v<Book, TStdOrderBook>) {
+            if (op == 1) {
+                book.Erase(p);
+            } else if (op == 2) {
+                book.Sweep(p, 10);
+            } else if (auto* level = book.Get(p)) {
+                level->Do();
+            }
+        } else {
+            if (op == 1) {
+                book.erase(p);
+            } else if (op == 2) {
+                int count = 10;
+                for (auto it = book.lower_bound(p); it != book.end() && count-- > 0; ++it) {
+                    it->Do();
+                }
+            } else if (auto* level = book.get(p)) {
+                level->Do();
+            }
+        }
+    }
+    benchmark::DoNotOptimize(counter);
+}
+
 } // namespace
 
+// the engines only hold a reference, so they can be relocated bytewise
+STATIC_PTR_TRIVIALLY_RELOCATABLE(IEngine)
+STATIC_PTR_TRIVIALLY_RELOCATABLE(ILightEngine)
+STATIC_PTR_TRIVIALLY_RELOCATABLE(IReplay)
+
 BENCHMARK(BM_SingleSmartPointer<std::unique_ptr<IEngine>>);
 BENCHMARK(BM_SingleSmartPointer<sp::static_ptr<IEngine>>);
 
+BENCHMARK(BM_EmplaceResetChurn<IEngine, TSteamEngine, TJetEngine>);
+BENCHMARK(BM_EmplaceResetChurn<ILightEngine, TLightSteamEngine, TLightJetEngine>);
+
 BENCHMARK(BM_IteratingOverSmartPointer<std::unique_ptr<IEngine>>);
 BENCHMARK(BM_IteratingOverSmartPointer<sp::static_ptr<IEngine>>);
 
+BENCHMARK(BM_GrowingContainer<std::vector<sp::static_ptr<IEngine>>>)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_GrowingContainer<sp::huge_vector<sp::static_ptr<IEngine>>>)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_GrowingPolyDeque)->Range(1 << 10, 1 << 22);
+
+BENCHMARK(BM_IteratingOverContainer<std::vector<sp::static_ptr<IEngine>>>)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_IteratingOverContainer<sp::huge_vector<sp::static_ptr<IEngine>>>)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_IteratingOverPolyDeque)->Range(1 << 10, 1 << 22);
+
+BENCHMARK(BM_FactoryConstruction)->Range(1 << 10, 1 << 19);
+BENCHMARK(BM_BulkConstruction)->ArgsProduct({benchmark::CreateRange(1 << 10, 1 << 19, 8), {1, 4}});
+
+BENCHMARK(BM_TreeTraversal_UniquePtr)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_TreeTraversal_NodeArena)->Range(1 << 10, 1 << 20);
+
+BENCHMARK(BM_Interpreter_Virtual);
+BENCHMARK(BM_Interpreter_Switch);
+BENCHMARK(BM_Interpreter_Threaded<false>);
+BENCHMARK(BM_Interpreter_Threaded<true>);
+
+BENCHMARK(BM_LruCache<TStdLruCache>);
+BENCHMARK(BM_LruCache<sp::lru_cache<uint64_t, IEngine>>);
+
+BENCHMARK(BM_SortByVirtualKey<false>)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_SortByVirtualKey<true>)->Range(1 << 10, 1 << 20);
+
+BENCHMARK(BM_OrderRejects<THeapResult>);
+BENCHMARK(BM_OrderRejects<TStaticResult>);
+
+BENCHMARK(BM_TraceReplay<std::vector<std::unique_ptr<IReplay>>>);
+BENCHMARK(BM_TraceReplay<std::vector<sp::static_ptr<IReplay, 128>>>);
+BENCHMARK(BM_TraceReplay<sp::huge_vector<sp::static_ptr<IReplay, 128>>>);
+
+BENCHMARK(BM_OrderBook<TStdOrderBook>)->Range(1 << 8, 1 << 18);
+BENCHMARK(BM_OrderBook<sp::btree_map<int64_t, IEngine>>)->Range(1 << 8, 1 << 18);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,78 @@
+#!/bin/sh
+# Build-time benchmark: compiles N generated translation units which use
+# static_ptr through `#include "static_ptr.h"` and through `import static_ptr;`
+#
+# usage: ./benchmark/build_time.sh [N] [JOBS]
+# N defaults to 3000, JOBS defaults to the number of CPUs
+# only GCC (`-fmodules-ts`) is supported, set CXX to choose the compiler
+
+set -e
+
+N=${1:-3000}
+JOBS=${2:-$(nproc)}
+CXX=${CXX:-g++}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# generate a translation unit, `$1` is the way to get static_ptr
+generate() {
+    cat <<TU
+$1
+
+namespace {
+
+struct IShape {
+    virtual ~IShape() = default;
+    virtual int Area() const = 0;
+};
+
+struct TSquare : IShape {
+    TSquare(int side) : Side{side} {}
+    int Area() const override { return Side * Side; }
+    int Side;
+};
+
+} // namespace
+
+int Unit$2(int side) {
+    sp::static_ptr<IShape> shape = sp::make_static<TSquare>(side);
+    sp::static_ptr<IShape> other;
+    other = std::move(shape);
+    return other->Area();
+}
+TU
+}
+
+mkdir -p "$WORK/header" "$WORK/module"
+i=0
+while [ "$i" -lt "$N" ]; do
+    generate '#include "static_ptr.h"' "$i" > "$WORK/header/tu$i.cc"
+    # GCC 12 needs the standard headers to be included before the import
+    generate '#include <new>
+#include <utility>
+import static_ptr;' "$i" > "$WORK/module/tu$i.cc"
+    i=$((i + 1))
+done
+
+now() {
+    date +%s.%N
+}
+
+compile_all() {
+    ls "$1"/*.cc | xargs -P "$JOBS" -I{} $CXX -std=c++20 $2 -c {} -o {}.o
+}
+
+start=$(now)
+compile_all "$WORK/header" "-I$ROOT/include"
+header_time=$(awk "BEGIN { print $(now) - $start }")
+
+cd "$WORK/module"
+start=$(now)
+$CXX -std=c++20 -fmodules-ts -I"$ROOT/include" -x c++ -c "$ROOT/include/static_ptr.cppm" -o static_ptr.o
+compile_all "$WORK/module" "-fmodules-ts"
+module_time=$(awk "BEGIN { print $(now) - $start }")
+
+echo "translation units: $N, jobs: $JOBS"
+echo "#include: ${header_time}s"
+echo "import:   ${module_time}s"
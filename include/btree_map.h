@@ -0,0 +1,534 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace sp {
+
+// ordered map of polymorphic values stored inline in the leaves of a B+ tree
+// the keys of a node are contiguous, the leaves are linked for in-order iteration
+// the values are relocated by `static_ptr` moves when the nodes are split or
+// merged, so the values of trivially relocatable types are copied bytewise
+// the keys must be default constructible, a node holds `NodeSize` keys at most
+template<typename Key, typename Base, typename Compare = std::less<Key>, std::size_t BufferSize = 0, std::size_t NodeSize = 16>
+requires(NodeSize >= 4)
+class btree_map {
+private:
+    using slot = static_ptr<Base, BufferSize>;
+
+    static constexpr std::uint32_t capacity = NodeSize;
+    // the nodes except the root hold at least `min_size` keys
+    static constexpr std::uint32_t min_size = NodeSize / 2;
+    // every inner node has two children at least
+    static constexpr std::size_t max_height = 64;
+
+    // the nodes are value-initialized, so that the unused keys are valid
+    struct node {
+        std::uint32_t size = 0;
+    };
+
+    struct leaf_node : node {
+        leaf_node* next = nullptr;
+        Key keys[NodeSize];
+        slot values[NodeSize];
+    };
+
+    // the keys of `children[i]` are in [keys[i - 1], keys[i])
+    struct inner_node : node {
+        Key keys[NodeSize];
+        node* children[NodeSize + 1];
+    };
+
+    struct path_entry {
+        inner_node* node;
+        std::uint32_t index;
+    };
+
+    // equals to `nullptr` if the map is empty
+    node* root_ = nullptr;
+    // number of inner levels above the leaves
+    std::size_t height_ = 0;
+    std::size_t size_ = 0;
+    Compare compare_;
+
+    // the keys are compared with the whole node without branches,
+    // which the compiler vectorizes (64-bit integers need SSE4.2 on x86)
+    static constexpr bool vectorizable = std::is_arithmetic_v<Key>
+        && (std::is_same_v<Compare, std::less<Key>> || std::is_same_v<Compare, std::greater<Key>>
+            || std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::greater<>>);
+
+    // the counter is as wide as the keys, so that the comparisons fill the same lanes
+    using rank_counter = std::conditional_t<sizeof(Key) == 8, std::uint64_t, std::uint32_t>;
+
+    // number of keys less than `key`, or not greater than it if `Upper`
+    template<bool Upper>
+    std::uint32_t rank(const Key* keys, std::uint32_t size, const Key& key) const {
+        if constexpr (vectorizable) {
+            rank_counter count = 0;
+            for (std::uint32_t i = 0; i < capacity; ++i) {
+                const bool before = Upper ? !compare_(key, keys[i]) : compare_(keys[i], key);
+                count += static_cast<rank_counter>(before & (rank_counter{i} < rank_counter{size}));
+            }
+            return static_cast<std::uint32_t>(count);
+        } else if constexpr (Upper) {
+            return static_cast<std::uint32_t>(std::upper_bound(keys, keys + size, key, compare_) - keys);
+        } else {
+            return static_cast<std::uint32_t>(std::lower_bound(keys, keys + size, key, compare_) - keys);
+        }
+    }
+
+    bool found(const leaf_node* leaf, std::uint32_t pos, const Key& key) const {
+        return pos < leaf->size && !compare_(key, leaf->keys[pos]);
+    }
+
+    // the leaf that may hold the key, the map must not be empty
+    // the inner nodes on the way are stored to `path` from the bottom
+    leaf_node* descend(const Key& key, path_entry* path = nullptr) const {
+        node* n = root_;
+        for (std::size_t level = height_; level > 0; --level) {
+            auto* inner = static_cast<inner_node*>(n);
+            const std::uint32_t index = rank<true>(inner->keys, inner->size, key);
+            if (path) {
+                path[level - 1] = {inner, index};
+            }
+            n = inner->children[index];
+        }
+        return static_cast<leaf_node*>(n);
+    }
+
+    // the leaf must not be full
+    static slot& insert_at(leaf_node* leaf, std::uint32_t pos, const Key& key, slot& value) {
+        std::move_backward(leaf->keys + pos, leaf->keys + leaf->size, leaf->keys + leaf->size + 1);
+        std::move_backward(leaf->values + pos, leaf->values + leaf->size, leaf->values + leaf->size + 1);
+        leaf->keys[pos] = key;
+        leaf->values[pos] = std::move(value);
+        ++leaf->size;
+        return leaf->values[pos];
+    }
+
+    // the node must not be full
+    static void insert_at(inner_node* inner, std::uint32_t index, Key& key, node* right) {
+        std::move_backward(inner->keys + index, inner->keys + inner->size, inner->keys + inner->size + 1);
+        std::copy_backward(inner->children + index + 1, inner->children + inner->size + 1, inner->children + inner->size + 2);
+        inner->keys[index] = std::move(key);
+        inner->children[index + 1] = right;
+        ++inner->size;
+    }
+
+    // insert `key` and `right` into the full node, splitting it into `inner` and `fresh`
+    // `key` and `right` are replaced by the separator and `fresh`
+    static void split_insert(inner_node* inner, std::uint32_t index, Key& key, node*& right, inner_node* fresh) {
+        Key keys[capacity + 1];
+        node* children[capacity + 2];
+        std::move(inner->keys, inner->keys + index, keys);
+        keys[index] = std::move(key);
+        std::move(inner->keys + index, inner->keys + capacity, keys + index + 1);
+        std::copy(inner->children, inner->children + index + 1, children);
+        children[index + 1] = right;
+        std::copy(inner->children + index + 1, inner->children + capacity + 1, children + index + 2);
+
+        const std::uint32_t mid = (capacity + 1) / 2;
+        std::move(keys, keys + mid, inner->keys);
+        std::copy(children, children + mid + 1, inner->children);
+        inner->size = mid;
+        std::move(keys + mid + 1, keys + capacity + 1, fresh->keys);
+        std::copy(children + mid + 1, children + capacity + 2, fresh->children);
+        fresh->size = capacity - mid;
+        key = std::move(keys[mid]);
+        right = fresh;
+    }
+
+    // insert into the full leaf at the bottom of `path`, splitting the nodes up the path
+    // the new nodes are allocated beforehand, so the tree is intact if it throws
+    slot& split_insert(path_entry* path, leaf_node* leaf, std::uint32_t pos, const Key& key, slot& value) {
+        std::size_t inner_splits = 0;
+        while (inner_splits < height_ && path[inner_splits].node->size == capacity) {
+            ++inner_splits;
+        }
+        const std::size_t fresh_count = inner_splits + (inner_splits == height_);
+        auto right_leaf = std::make_unique<leaf_node>();
+        inner_node* fresh[max_height + 1];
+        std::size_t allocated = 0;
+        try {
+            for (; allocated < fresh_count; ++allocated) {
+                fresh[allocated] = new inner_node();
+            }
+        } catch (...) {
+            while (allocated > 0) {
+                delete fresh[--allocated];
+            }
+            throw;
+        }
+
+        leaf_node* right = right_leaf.release();
+        const std::uint32_t half = capacity / 2;
+        std::move(leaf->keys + half, leaf->keys + capacity, right->keys);
+        std::move(leaf->values + half, leaf->values + capacity, right->values);
+        right->size = capacity - half;
+        leaf->size = half;
+        right->next = leaf->next;
+        leaf->next = right;
+        slot& result = pos > half ? insert_at(right, pos - half, key, value) : insert_at(leaf, pos, key, value);
+
+        Key separator = right->keys[0];
+        node* child = right;
+        for (std::size_t level = 0; level < inner_splits; ++level) {
+            split_insert(path[level].node, path[level].index, separator, child, fresh[level]);
+        }
+        if (inner_splits < height_) {
+            insert_at(path[inner_splits].node, path[inner_splits].index, separator, child);
+        } else {
+            inner_node* root = fresh[inner_splits];
+            root->keys[0] = std::move(separator);
+            root->children[0] = root_;
+            root->children[1] = child;
+            root->size = 1;
+            root_ = root;
+            ++height_;
+        }
+        return result;
+    }
+
+    // move the entries of `children[index + 1]` to `children[index]`
+    static void merge(inner_node* parent, std::uint32_t index, bool leaves) {
+        if (leaves) {
+            auto* left = static_cast<leaf_node*>(parent->children[index]);
+            auto* right = static_cast<leaf_node*>(parent->children[index + 1]);
+            std::move(right->keys, right->keys + right->size, left->keys + left->size);
+            std::move(right->values, right->values + right->size, left->values + left->size);
+            left->size += right->size;
+            left->next = right->next;
+            delete right;
+        } else {
+            auto* left = static_cast<inner_node*>(parent->children[index]);
+            auto* right = static_cast<inner_node*>(parent->children[index + 1]);
+            left->keys[left->size] = std::move(parent->keys[index]);
+            std::move(right->keys, right->keys + right->size, left->keys + left->size + 1);
+            std::copy(right->children, right->children + right->size + 1, left->children + left->size + 1);
+            left->size += right->size + 1;
+            delete right;
+        }
+        std::move(parent->keys + index + 1, parent->keys + parent->size, parent->keys + index);
+        std::copy(parent->children + index + 2, parent->children + parent->size + 1, parent->children + index + 1);
+        --parent->size;
+    }
+
+    // move the last entry of `children[index - 1]` to `children[index]`
+    static void borrow_left(inner_node* parent, std::uint32_t index, bool leaves) {
+        if (leaves) {
+            auto* left = static_cast<leaf_node*>(parent->children[index - 1]);
+            auto* child = static_cast<leaf_node*>(parent->children[index]);
+            std::move_backward(child->keys, child->keys + child->size, child->keys + child->size + 1);
+            std::move_backward(child->values, child->values + child->size, child->values + child->size + 1);
+            --left->size;
+            child->keys[0] = std::move(left->keys[left->size]);
+            child->values[0] = std::move(left->values[left->size]);
+            ++child->size;
+            parent->keys[index - 1] = child->keys[0];
+        } else {
+            auto* left = static_cast<inner_node*>(parent->children[index - 1]);
+            auto* child = static_cast<inner_node*>(parent->children[index]);
+            std::move_backward(child->keys, child->keys + child->size, child->keys + child->size + 1);
+            std::copy_backward(child->children, child->children + child->size + 1, child->children + child->size + 2);
+            child->keys[0] = std::move(parent->keys[index - 1]);
+            child->children[0] = left->children[left->size];
+            ++child->size;
+            --left->size;
+            parent->keys[index - 1] = std::move(left->keys[left->size]);
+        }
+    }
+
+    // move the first entry of `children[index + 1]` to `children[index]`
+    static void borrow_right(inner_node* parent, std::uint32_t index, bool leaves) {
+        if (leaves) {
+            auto* child = static_cast<leaf_node*>(parent->children[index]);
+            auto* right = static_cast<leaf_node*>(parent->children[index + 1]);
+            child->keys[child->size] = std::move(right->keys[0]);
+            child->values[child->size] = std::move(right->values[0]);
+            ++child->size;
+            std::move(right->keys + 1, right->keys + right->size, right->keys);
+            std::move(right->values + 1, right->values + right->size, right->values);
+            --right->size;
+            parent->keys[index] = right->keys[0];
+        } else {
+            auto* child = static_cast<inner_node*>(parent->children[index]);
+            auto* right = static_cast<inner_node*>(parent->children[index + 1]);
+            child->keys[child->size] = std::move(parent->keys[index]);
+            child->children[child->size + 1] = right->children[0];
+            ++child->size;
+            parent->keys[index] = std::move(right->keys[0]);
+            std::move(right->keys + 1, right->keys + right->size, right->keys);
+            std::copy(right->children + 1, right->children + right->size + 1, right->children);
+            --right->size;
+        }
+    }
+
+    // restore the minimal sizes of the nodes on the path after an erase from `leaf`
+    void rebalance(path_entry* path, leaf_node* leaf) {
+        node* n = leaf;
+        for (std::size_t level = 0; level < height_; ++level) {
+            if (n->size >= min_size) {
+                return;
+            }
+            const auto [parent, index] = path[level];
+            const bool leaves = level == 0;
+            if (index > 0 && parent->children[index - 1]->size > min_size) {
+                borrow_left(parent, index, leaves);
+            } else if (index < parent->size && parent->children[index + 1]->size > min_size) {
+                borrow_right(parent, index, leaves);
+            } else if (index > 0) {
+                merge(parent, index - 1, leaves);
+            } else {
+                merge(parent, index, leaves);
+            }
+            n = parent;
+        }
+        if (root_->size > 0) {
+            return;
+        }
+        if (height_ == 0) {
+            delete static_cast<leaf_node*>(root_);
+            root_ = nullptr;
+        } else {
+            auto* root = static_cast<inner_node*>(root_);
+            root_ = root->children[0];
+            --height_;
+            delete root;
+        }
+    }
+
+    static void destroy(node* n, std::size_t level) noexcept(std::is_nothrow_destructible_v<Base>) {
+        if (level == 0) {
+            delete static_cast<leaf_node*>(n);
+            return;
+        }
+        auto* inner = static_cast<inner_node*>(n);
+        for (std::uint32_t i = 0; i <= inner->size; ++i) {
+            destroy(inner->children[i], level - 1);
+        }
+        delete inner;
+    }
+
+    template<bool Const>
+    class basic_iterator {
+    private:
+        friend class btree_map;
+        friend class basic_iterator<!Const>;
+
+        leaf_node* leaf_;
+        std::uint32_t pos_;
+
+        basic_iterator(leaf_node* leaf, std::uint32_t pos) noexcept : leaf_{leaf}, pos_{pos} {}
+
+    public:
+        using value_type = Base;
+        using reference = std::conditional_t<Const, const Base&, Base&>;
+        using pointer = std::conditional_t<Const, const Base*, Base*>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        basic_iterator() noexcept : leaf_{nullptr}, pos_{0} {}
+
+        // non-const to const conversion
+        template<bool RhsConst>
+        basic_iterator(const basic_iterator<RhsConst>& rhs) noexcept requires(Const && !RhsConst)
+            : leaf_{rhs.leaf_}, pos_{rhs.pos_}
+        {}
+
+        const Key& key() const noexcept { return leaf_->keys[pos_]; }
+
+        reference operator*() const noexcept { return *leaf_->values[pos_]; }
+        pointer operator->() const noexcept { return leaf_->values[pos_].get(); }
+
+        basic_iterator& operator++() noexcept {
+            if (++pos_ == leaf_->size) {
+                leaf_ = leaf_->next;
+                pos_ = 0;
+            }
+            return *this;
+        }
+
+        basic_iterator operator++(int) noexcept {
+            basic_iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const basic_iterator& rhs) const noexcept {
+            return leaf_ == rhs.leaf_ && pos_ == rhs.pos_;
+        }
+    };
+
+    // the iterator to `pos` of the leaf, which may be past its end
+    template<typename Iterator>
+    static Iterator make_iterator(leaf_node* leaf, std::uint32_t pos) noexcept {
+        if (pos == leaf->size) {
+            return {leaf->next, 0};
+        }
+        return {leaf, pos};
+    }
+
+    template<typename Iterator, bool Upper>
+    Iterator bound(const Key& key) const {
+        if (!root_) {
+            return {};
+        }
+        leaf_node* leaf = descend(key);
+        return make_iterator<Iterator>(leaf, rank<Upper>(leaf->keys, leaf->size, key));
+    }
+
+    template<typename Iterator>
+    Iterator find_iterator(const Key& key) const {
+        if (!root_) {
+            return {};
+        }
+        leaf_node* leaf = descend(key);
+        const std::uint32_t pos = rank<false>(leaf->keys, leaf->size, key);
+        return found(leaf, pos, key) ? Iterator{leaf, pos} : Iterator{};
+    }
+
+    leaf_node* first_leaf() const noexcept {
+        node* n = root_;
+        for (std::size_t level = height_; n && level > 0; --level) {
+            n = static_cast<inner_node*>(n)->children[0];
+        }
+        return static_cast<leaf_node*>(n);
+    }
+
+public:
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    explicit btree_map(Compare compare = {}) : compare_{std::move(compare)} {}
+
+    btree_map(btree_map&& rhs) noexcept
+        : root_{std::exchange(rhs.root_, nullptr)}
+        , height_{std::exchange(rhs.height_, 0)}
+        , size_{std::exchange(rhs.size_, 0)}
+        , compare_{rhs.compare_}
+    {}
+
+    btree_map& operator=(btree_map&& rhs) noexcept(std::is_nothrow_destructible_v<Base>) {
+        if (this != &rhs) {
+            clear();
+            root_ = std::exchange(rhs.root_, nullptr);
+            height_ = std::exchange(rhs.height_, 0);
+            size_ = std::exchange(rhs.size_, 0);
+            compare_ = rhs.compare_;
+        }
+        return *this;
+    }
+
+    btree_map(const btree_map&) = delete;
+    btree_map& operator=(const btree_map&) = delete;
+
+    ~btree_map() {
+        clear();
+    }
+
+    // construct the value of the key, replacing the old value
+    // the map is unchanged if the constructor throws
+    template<typename Derived = Base, typename ...Args>
+    Derived& emplace(const Key& key, Args&&... args) {
+        slot value;
+        value.template emplace<Derived>(std::forward<Args>(args)...);
+        if (!root_) {
+            root_ = new leaf_node();
+        }
+
+        path_entry path[max_height];
+        leaf_node* leaf = descend(key, path);
+        const std::uint32_t pos = rank<false>(leaf->keys, leaf->size, key);
+        if (found(leaf, pos, key)) {
+            leaf->values[pos] = std::move(value);
+            return static_cast<Derived&>(*leaf->values[pos]);
+        }
+        slot& result = leaf->size < capacity ? insert_at(leaf, pos, key, value) : split_insert(path, leaf, pos, key, value);
+        ++size_;
+        return static_cast<Derived&>(*result);
+    }
+
+    bool erase(const Key& key) {
+        if (!root_) {
+            return false;
+        }
+        path_entry path[max_height];
+        leaf_node* leaf = descend(key, path);
+        const std::uint32_t pos = rank<false>(leaf->keys, leaf->size, key);
+        if (!found(leaf, pos, key)) {
+            return false;
+        }
+        std::move(leaf->keys + pos + 1, leaf->keys + leaf->size, leaf->keys + pos);
+        std::move(leaf->values + pos + 1, leaf->values + leaf->size, leaf->values + pos);
+        --leaf->size;
+        leaf->values[leaf->size].reset();
+        --size_;
+        rebalance(path, leaf);
+        return true;
+    }
+
+    void clear() noexcept(std::is_nothrow_destructible_v<Base>) {
+        if (root_) {
+            destroy(root_, height_);
+            root_ = nullptr;
+            height_ = 0;
+            size_ = 0;
+        }
+    }
+
+    // lookups
+    // the value of the key, `nullptr` if the key is absent
+    Base* get(const Key& key) {
+        const iterator it = find(key);
+        return it == end() ? nullptr : it.operator->();
+    }
+    const Base* get(const Key& key) const {
+        const const_iterator it = find(key);
+        return it == end() ? nullptr : it.operator->();
+    }
+
+    bool contains(const Key& key) const {
+        return find(key) != end();
+    }
+
+    iterator find(const Key& key) { return find_iterator<iterator>(key); }
+    const_iterator find(const Key& key) const { return find_iterator<const_iterator>(key); }
+
+    // the first entry whose key is not less than `key`
+    iterator lower_bound(const Key& key) { return bound<iterator, false>(key); }
+    const_iterator lower_bound(const Key& key) const { return bound<const_iterator, false>(key); }
+
+    // the first entry whose key is greater than `key`
+    iterator upper_bound(const Key& key) { return bound<iterator, true>(key); }
+    const_iterator upper_bound(const Key& key) const { return bound<const_iterator, true>(key); }
+
+    // accessors
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    // call `fn(const Key&, Base&)` in the order of the keys
+    template<typename F>
+    void for_each(F&& fn) {
+        for (leaf_node* leaf = first_leaf(); leaf; leaf = leaf->next) {
+            for (std::uint32_t i = 0; i < leaf->size; ++i) {
+                fn(std::as_const(leaf->keys[i]), *leaf->values[i]);
+            }
+        }
+    }
+
+    // iterators, in the order of the keys
+    iterator begin() noexcept { return {first_leaf(), 0}; }
+    iterator end() noexcept { return {}; }
+    const_iterator begin() const noexcept { return {first_leaf(), 0}; }
+    const_iterator end() const noexcept { return {}; }
+};
+
+} // namespace sp
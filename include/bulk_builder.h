@@ -0,0 +1,258 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace sp {
+
+// header of a record in a descriptor table
+// the header is followed by `size` bytes of the constructor payload,
+// records are packed without any padding
+struct bulk_record_header {
+    std::uint32_t type_id;
+    std::uint32_t size;
+};
+
+// builder of descriptor tables
+class bulk_table_writer {
+private:
+    std::vector<std::byte> data_;
+    std::size_t records_ = 0;
+
+public:
+    // append a record with a raw payload
+    void add(std::uint32_t type_id, std::span<const std::byte> payload) {
+        const bulk_record_header header{type_id, static_cast<std::uint32_t>(payload.size())};
+        const auto* bytes = reinterpret_cast<const std::byte*>(&header);
+        data_.insert(data_.end(), bytes, bytes + sizeof(header));
+        data_.insert(data_.end(), payload.begin(), payload.end());
+        ++records_;
+    }
+
+    // append a record with a trivially copyable payload
+    template<typename Payload>
+    void add(std::uint32_t type_id, const Payload& payload)
+        requires(std::is_trivially_copyable_v<Payload>)
+    {
+        add(type_id, std::as_bytes(std::span{&payload, 1}));
+    }
+
+    std::span<const std::byte> data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return records_; }
+};
+
+// parallel construction options
+struct bulk_options {
+    // number of threads constructing the objects, including the caller
+    std::size_t threads = 1;
+    // number of objects a thread takes at once
+    std::size_t chunk_size = 4096;
+};
+
+// memory used by the built objects
+struct bulk_footprint {
+    std::size_t objects = 0;
+    // bytes taken by the slots
+    std::size_t storage_bytes = 0;
+    // bytes taken by the objects themselves, the rest of the slots is unused
+    std::size_t object_bytes = 0;
+};
+
+// builder of polymorphic objects from a descriptor table
+// the types are registered by ids, then each record of a table is
+// constructed directly in its final slot, without a factory call per
+// object and without moves
+template<typename Base, std::size_t BufferSize = 0>
+class bulk_builder {
+public:
+    using slot_type = static_ptr<Base, BufferSize>;
+
+private:
+    using construct_func_type = void(*)(slot_type& slot, std::span<const std::byte> payload);
+
+    // payload size of the types constructed from the raw payload
+    static constexpr std::size_t any_payload = static_cast<std::size_t>(-1);
+
+    struct type_entry {
+        construct_func_type construct_func;
+        std::size_t object_size;
+        // checked by `scan`, so that a bad record fails before anything is built
+        std::size_t payload_size;
+    };
+
+    // validated table, split into chunks of records
+    struct layout {
+        // offset of the first record of each chunk
+        std::vector<std::size_t> chunk_offsets;
+        bulk_footprint footprint;
+    };
+
+    std::unordered_map<std::uint32_t, type_entry> types_;
+
+    template<typename Derived>
+    static void construct_raw(slot_type& slot, std::span<const std::byte> payload) {
+        slot.template emplace<Derived>(payload);
+    }
+
+    // the payload size is validated by `scan`
+    template<typename Derived, typename Payload>
+    static void construct_typed(slot_type& slot, std::span<const std::byte> payload) {
+        std::array<std::byte, sizeof(Payload)> bytes;
+        std::memcpy(bytes.data(), payload.data(), sizeof(Payload));
+        slot.template emplace<Derived>(std::bit_cast<Payload>(bytes));
+    }
+
+    void add_type(std::uint32_t type_id, construct_func_type func, std::size_t object_size, std::size_t payload_size) {
+        if (!types_.emplace(type_id, type_entry{func, object_size, payload_size}).second) {
+            throw std::invalid_argument("sp::bulk_builder: type id is already registered");
+        }
+    }
+
+    static bulk_record_header read_header(std::span<const std::byte> table, std::size_t pos) {
+        bulk_record_header header;
+        std::memcpy(&header, table.data() + pos, sizeof(header));
+        return header;
+    }
+
+    // validate the table and split it into chunks of `chunk_size` records
+    layout scan(std::span<const std::byte> table, std::size_t chunk_size) const {
+        layout result;
+        std::size_t pos = 0;
+        while (pos < table.size()) {
+            if (table.size() - pos < sizeof(bulk_record_header)) {
+                throw std::invalid_argument("sp::bulk_builder: truncated record header");
+            }
+            const bulk_record_header header = read_header(table, pos);
+            if (table.size() - pos - sizeof(header) < header.size) {
+                throw std::invalid_argument("sp::bulk_builder: truncated record payload");
+            }
+            const auto it = types_.find(header.type_id);
+            if (it == types_.end()) {
+                throw std::invalid_argument("sp::bulk_builder: unknown type id");
+            }
+            if (it->second.payload_size != any_payload && it->second.payload_size != header.size) {
+                throw std::invalid_argument("sp::bulk_builder: payload size mismatch");
+            }
+            if (result.footprint.objects % chunk_size == 0) {
+                result.chunk_offsets.push_back(pos);
+            }
+            ++result.footprint.objects;
+            result.footprint.object_bytes += it->second.object_size;
+            pos += sizeof(header) + header.size;
+        }
+        result.footprint.storage_bytes = result.footprint.objects * sizeof(slot_type);
+        return result;
+    }
+
+    // construct the records of a chunk, the table must be validated
+    void construct_chunk(std::span<const std::byte> table, std::size_t pos, std::span<slot_type> slots) const {
+        for (auto& slot : slots) {
+            const bulk_record_header header = read_header(table, pos);
+            pos += sizeof(header);
+            (types_.find(header.type_id)->second.construct_func)(slot, table.subspan(pos, header.size));
+            pos += header.size;
+        }
+    }
+
+    void construct(std::span<const std::byte> table, const layout& chunks, std::size_t chunk_size,
+                   std::span<slot_type> slots, std::size_t threads) const {
+        const std::size_t count = chunks.chunk_offsets.size();
+        threads = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(count, 1));
+
+        std::atomic<std::size_t> next{0};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto work = [&] {
+            try {
+                for (std::size_t chunk; (chunk = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+                    const std::size_t first = chunk * chunk_size;
+                    const std::size_t last = std::min(slots.size(), first + chunk_size);
+                    construct_chunk(table, chunks.chunk_offsets[chunk], slots.subspan(first, last - first));
+                }
+            } catch (...) {
+                // stop the other threads too
+                next.store(count, std::memory_order_relaxed);
+                std::lock_guard guard{error_mutex};
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        try {
+            workers.reserve(threads - 1);
+            for (std::size_t i = 1; i < threads; ++i) {
+                workers.emplace_back(work);
+            }
+        } catch (...) {
+            // a thread couldn't be started, the started ones finish their chunks
+            next.store(count, std::memory_order_relaxed);
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            throw;
+        }
+        work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+public:
+    // registration of the types
+    // `Derived` is constructed from the raw payload as `std::span<const std::byte>`
+    template<typename Derived>
+    void register_type(std::uint32_t type_id)
+        requires(std::is_base_of_v<Base, Derived> && std::is_constructible_v<Derived, std::span<const std::byte>>)
+    {
+        add_type(type_id, &construct_raw<Derived>, sizeof(Derived), any_payload);
+    }
+
+    // `Derived` is constructed from the payload read as a trivially copyable `Payload`
+    template<typename Derived, typename Payload>
+    void register_type(std::uint32_t type_id)
+        requires(std::is_base_of_v<Base, Derived>
+            && std::is_trivially_copyable_v<Payload>
+            && std::is_constructible_v<Derived, Payload>)
+    {
+        add_type(type_id, &construct_typed<Derived, Payload>, sizeof(Derived), sizeof(Payload));
+    }
+
+    // construct the objects of the table at the end of `out`
+    // the table is validated before any object is constructed; if a
+    // constructor throws, the new objects are destructed and `out` is restored
+    bulk_footprint build(std::span<const std::byte> table, std::vector<slot_type>& out, bulk_options options = {}) const {
+        const std::size_t chunk_size = std::max<std::size_t>(options.chunk_size, 1);
+        const layout chunks = scan(table, chunk_size);
+        const std::size_t first = out.size();
+        out.resize(first + chunks.footprint.objects);
+        try {
+            construct(table, chunks, chunk_size, std::span{out}.subspan(first), options.threads);
+        } catch (...) {
+            out.resize(first);
+            throw;
+        }
+        return chunks.footprint;
+    }
+};
+
+} // namespace sp
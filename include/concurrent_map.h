@@ -0,0 +1,229 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace sp {
+
+// lock-striped concurrent hash map with inline polymorphic values
+// the keys are spread over `Shards` shards, each of them is an open
+// addressing table of static_ptr slots guarded by its own shared mutex
+template<typename Key, typename Base, typename Hash = std::hash<Key>, std::size_t Shards = 16>
+class concurrent_map {
+private:
+    static_assert(std::has_single_bit(Shards), "the number of shards must be a power of two");
+
+    static constexpr std::size_t min_capacity = 16;
+
+    struct bucket {
+        // equals to `std::nullopt` for empty and erased buckets
+        std::optional<Key> key;
+        // the bucket is erased, probing continues past it
+        bool erased = false;
+        static_ptr<Base> value;
+    };
+
+    // a shard has its own cache line so that the locks don't share it
+    struct alignas(64) shard {
+        mutable std::shared_mutex mutex;
+        std::vector<bucket> buckets;
+        std::size_t size = 0;
+        std::size_t erased = 0;
+    };
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    Hash hash_;
+    shard shards_[Shards];
+
+    // mix the bits, so that the low bits pick the bucket and the high bits pick the shard
+    std::uint64_t hash(const Key& key) const {
+        return static_cast<std::uint64_t>(hash_(key)) * 0x9E3779B97F4A7C15ull;
+    }
+
+    shard& shard_for(std::uint64_t h) noexcept {
+        return shards_[(h >> 32) & (Shards - 1)];
+    }
+
+    const shard& shard_for(std::uint64_t h) const noexcept {
+        return shards_[(h >> 32) & (Shards - 1)];
+    }
+
+    // must be called under the shard's lock
+    static std::size_t find(const shard& s, std::uint64_t h, const Key& key) {
+        if (s.buckets.empty()) {
+            return npos;
+        }
+        const std::size_t mask = s.buckets.size() - 1;
+        for (std::size_t i = (h >> 7) & mask;; i = (i + 1) & mask) {
+            const bucket& b = s.buckets[i];
+            if (b.key) {
+                if (*b.key == key) {
+                    return i;
+                }
+            } else if (!b.erased) {
+                return npos;
+            }
+        }
+    }
+
+    void rehash(shard& s, std::size_t capacity) {
+        std::vector<bucket> old = std::exchange(s.buckets, std::vector<bucket>(capacity));
+        s.erased = 0;
+        for (auto& b : old) {
+            if (b.key) {
+                bucket& dst = s.buckets[free_bucket(s, hash(*b.key))];
+                dst.key = std::move(b.key);
+                dst.value = std::move(b.value);
+            }
+        }
+    }
+
+    // first empty or erased bucket for the hash, the table must have one
+    static std::size_t free_bucket(const shard& s, std::uint64_t h) {
+        const std::size_t mask = s.buckets.size() - 1;
+        for (std::size_t i = (h >> 7) & mask;; i = (i + 1) & mask) {
+            if (!s.buckets[i].key) {
+                return i;
+            }
+        }
+    }
+
+    // must be called under the shard's unique lock
+    // returns the bucket for the key and whether it's new
+    std::pair<bucket*, bool> insert(shard& s, std::uint64_t h, const Key& key) {
+        if (const std::size_t pos = find(s, h, key); pos != npos) {
+            return {&s.buckets[pos], false};
+        }
+        // keep the load factor (including erased buckets) below 3/4
+        if (4 * (s.size + s.erased + 1) > 3 * s.buckets.size()) {
+            const std::size_t capacity = std::max(min_capacity, s.buckets.size());
+            rehash(s, 4 * (s.size + 1) > capacity ? 2 * capacity : capacity);
+        }
+        bucket& b = s.buckets[free_bucket(s, h)];
+        if (b.erased) {
+            b.erased = false;
+            --s.erased;
+        }
+        b.key.emplace(key);
+        ++s.size;
+        return {&b, true};
+    }
+
+    // must be called under the shard's unique lock
+    static void erase(shard& s, bucket& b) noexcept(std::is_nothrow_destructible_v<Base>) {
+        b.value.reset();
+        b.key.reset();
+        b.erased = true;
+        --s.size;
+        ++s.erased;
+    }
+
+    // the old value is gone if the constructor throws, so is the key
+    template<typename Derived, typename ...Args>
+    static void construct(shard& s, bucket& b, Args&&... args) {
+        try {
+            b.value.template emplace<Derived>(std::forward<Args>(args)...);
+        } catch (...) {
+            erase(s, b);
+            throw;
+        }
+    }
+
+public:
+    concurrent_map() = default;
+
+    concurrent_map(const concurrent_map&) = delete;
+    concurrent_map& operator=(const concurrent_map&) = delete;
+
+    // construct the value directly in its slot, replacing the old value
+    template<typename Derived = Base, typename ...Args>
+    void emplace(const Key& key, Args&&... args) {
+        const std::uint64_t h = hash(key);
+        shard& s = shard_for(h);
+        std::unique_lock guard{s.mutex};
+        bucket* b = insert(s, h, key).first;
+        construct<Derived>(s, *b, std::forward<Args>(args)...);
+    }
+
+    // construct the value only if the key is absent
+    // returns false if the key is present
+    template<typename Derived = Base, typename ...Args>
+    bool try_emplace(const Key& key, Args&&... args) {
+        const std::uint64_t h = hash(key);
+        shard& s = shard_for(h);
+        std::unique_lock guard{s.mutex};
+        auto [b, inserted] = insert(s, h, key);
+        if (inserted) {
+            construct<Derived>(s, *b, std::forward<Args>(args)...);
+        }
+        return inserted;
+    }
+
+    bool erase(const Key& key) {
+        const std::uint64_t h = hash(key);
+        shard& s = shard_for(h);
+        std::unique_lock guard{s.mutex};
+        const std::size_t pos = find(s, h, key);
+        if (pos == npos) {
+            return false;
+        }
+        erase(s, s.buckets[pos]);
+        return true;
+    }
+
+    // call `fn(const Base&)` in place under the shard's shared lock
+    // returns false if the key is absent
+    template<typename F>
+    bool visit(const Key& key, F&& fn) const {
+        const std::uint64_t h = hash(key);
+        const shard& s = shard_for(h);
+        std::shared_lock guard{s.mutex};
+        const std::size_t pos = find(s, h, key);
+        if (pos == npos) {
+            return false;
+        }
+        fn(static_cast<const Base&>(*s.buckets[pos].value));
+        return true;
+    }
+
+    // call `fn(Base&)` in place under the shard's unique lock
+    template<typename F>
+    bool visit_exclusive(const Key& key, F&& fn) {
+        const std::uint64_t h = hash(key);
+        shard& s = shard_for(h);
+        std::unique_lock guard{s.mutex};
+        const std::size_t pos = find(s, h, key);
+        if (pos == npos) {
+            return false;
+        }
+        fn(*s.buckets[pos].value);
+        return true;
+    }
+
+    bool contains(const Key& key) const {
+        return visit(key, [](const Base&) {});
+    }
+
+    // the size is not a snapshot if the map is modified concurrently
+    std::size_t size() const {
+        std::size_t size = 0;
+        for (const auto& s : shards_) {
+            std::shared_lock guard{s.mutex};
+            size += s.size;
+        }
+        return size;
+    }
+};
+
+} // namespace sp
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sp {
+
+// chunked copy-on-write vector of polymorphic objects
+// readers take an immutable snapshot and iterate it without locks, writers
+// publish a new version which shares all chunks but the modified one
+// all stored types must be copy constructible, chunks are copied with the
+// copy op of the ops table
+template<typename Base, std::size_t ChunkSize = 64>
+class cow_vector {
+private:
+    static_assert(ChunkSize > 0);
+
+    using chunk = std::vector<static_ptr<Base>>;
+    using chunk_ptr = std::shared_ptr<const chunk>;
+
+    template<typename Derived>
+    struct derived_class_check {
+        static constexpr bool ok = std::is_copy_constructible_v<Derived>;
+    };
+
+public:
+    // immutable version of the vector
+    class snapshot {
+    private:
+        friend class cow_vector;
+
+        std::vector<chunk_ptr> chunks_;
+        std::size_t size_ = 0;
+
+    public:
+        // iterator over the objects, chunk by chunk
+        class iterator {
+        private:
+            friend class snapshot;
+
+            const chunk_ptr* chunk_;
+            std::size_t pos_;
+
+            iterator(const chunk_ptr* chunk, std::size_t pos) noexcept : chunk_{chunk}, pos_{pos} {}
+
+        public:
+            using value_type = Base;
+            using reference = const Base&;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = std::forward_iterator_tag;
+
+            iterator() noexcept : chunk_{nullptr}, pos_{0} {}
+
+            reference operator*() const noexcept { return *(**chunk_)[pos_]; }
+            const Base* operator->() const noexcept { return (**chunk_)[pos_].get(); }
+
+            iterator& operator++() noexcept {
+                if (++pos_ == (*chunk_)->size()) {
+                    ++chunk_;
+                    pos_ = 0;
+                }
+                return *this;
+            }
+
+            iterator operator++(int) noexcept {
+                iterator tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            bool operator==(const iterator& rhs) const noexcept {
+                return chunk_ == rhs.chunk_ && pos_ == rhs.pos_;
+            }
+        };
+
+        const Base& operator[](std::size_t pos) const noexcept {
+            return *(*chunks_[pos / ChunkSize])[pos % ChunkSize];
+        }
+
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+
+        iterator begin() const noexcept { return {chunks_.data(), 0}; }
+        iterator end() const noexcept { return {chunks_.data() + chunks_.size(), 0}; }
+
+        // true if the chunk holding `pos` is shared with `rhs`
+        bool shares_chunk(const snapshot& rhs, std::size_t pos) const noexcept {
+            const std::size_t index = pos / ChunkSize;
+            return index < chunks_.size() && index < rhs.chunks_.size()
+                && chunks_[index] == rhs.chunks_[index];
+        }
+    };
+
+    using snapshot_ptr = std::shared_ptr<const snapshot>;
+
+private:
+    std::atomic<snapshot_ptr> current_;
+    // serializes writers, readers never take it
+    std::mutex write_mutex_;
+
+    static std::shared_ptr<chunk> clone_chunk(const chunk& src) {
+        auto dst = std::make_shared<chunk>();
+        dst->reserve(ChunkSize);
+        for (const auto& ptr : src) {
+            _::clone(dst->emplace_back(), ptr);
+        }
+        return dst;
+    }
+
+    // make a writable copy of `old` and publish it after `fn` modified the
+    // chunk `index` (which is appended if it doesn't exist)
+    // must be called under `write_mutex_`
+    template<typename F>
+    void update(const snapshot& old, std::size_t index, F&& fn) {
+        auto next = std::make_shared<snapshot>(old);
+
+        std::shared_ptr<chunk> modified;
+        if (index < next->chunks_.size()) {
+            modified = clone_chunk(*next->chunks_[index]);
+        } else {
+            modified = std::make_shared<chunk>();
+            modified->reserve(ChunkSize);
+            next->chunks_.emplace_back();
+        }
+        fn(*next, *modified);
+        if (modified->empty()) {
+            next->chunks_.pop_back();
+        } else {
+            next->chunks_[index] = std::move(modified);
+        }
+        current_.store(std::move(next), std::memory_order_release);
+    }
+
+public:
+    cow_vector() : current_{std::make_shared<const snapshot>()} {}
+
+    cow_vector(const cow_vector&) = delete;
+    cow_vector& operator=(const cow_vector&) = delete;
+
+    // readers
+    // the snapshot is immutable and stays valid while it's held
+    snapshot_ptr load() const {
+        return current_.load(std::memory_order_acquire);
+    }
+
+    std::size_t size() const {
+        return load()->size();
+    }
+
+    // writers
+    template<typename Derived = Base, typename ...Args>
+    void emplace_back(Args&&... args)
+        requires(derived_class_check<Derived>::ok)
+    {
+        std::lock_guard guard{write_mutex_};
+        const snapshot_ptr old = load();
+        update(*old, old->size() / ChunkSize, [&](snapshot& next, chunk& modified) {
+            modified.emplace_back().template emplace<Derived>(std::forward<Args>(args)...);
+            ++next.size_;
+        });
+    }
+
+    // replace the object at `pos` by a new object
+    template<typename Derived = Base, typename ...Args>
+    void emplace(std::size_t pos, Args&&... args)
+        requires(derived_class_check<Derived>::ok)
+    {
+        std::lock_guard guard{write_mutex_};
+        update(*load(), pos / ChunkSize, [&](snapshot&, chunk& modified) {
+            modified[pos % ChunkSize].template emplace<Derived>(std::forward<Args>(args)...);
+        });
+    }
+
+    // modify a copy of the object at `pos`, `fn` is called as `fn(Base&)`
+    template<typename F>
+    void modify(std::size_t pos, F&& fn) {
+        std::lock_guard guard{write_mutex_};
+        update(*load(), pos / ChunkSize, [&](snapshot&, chunk& modified) {
+            fn(*modified[pos % ChunkSize]);
+        });
+    }
+
+    void pop_back() {
+        std::lock_guard guard{write_mutex_};
+        const snapshot_ptr old = load();
+        update(*old, (old->size() - 1) / ChunkSize, [&](snapshot& next, chunk& modified) {
+            modified.pop_back();
+            --next.size_;
+        });
+    }
+};
+
+} // namespace sp
@@ -0,0 +1,225 @@
+#pragma once
+
+// sampling profiler of dereferences through `static_ptr::operator->`
+// it is compiled in only if STATIC_PTR_PROFILE is defined before including
+// `static_ptr.h`, all translation units must agree on it
+//
+// every N-th dereference in a thread records the call site, the base type
+// and the dynamic type into the thread's own buffer; `dispatch_report`
+// aggregates the samples into the type entropy per call site
+// the call sites are code addresses inside the functions dereferencing the pointers
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __has_include(<dlfcn.h>)
+#include <dlfcn.h>
+#endif
+
+namespace sp {
+
+struct dispatch_sample {
+    // code address of the dereference
+    const void* site;
+    const std::type_info* base;
+    const std::type_info* dynamic;
+};
+
+namespace _ {
+
+// append-only buffer written by a single thread
+// readers see the samples before `size`, the samples after it are dropped
+struct sample_buffer {
+    static constexpr std::size_t capacity = 1 << 14;
+
+    std::atomic<std::size_t> size{0};
+    std::atomic<std::size_t> dropped{0};
+    dispatch_sample samples[capacity];
+
+    void push(const dispatch_sample& sample) noexcept {
+        const std::size_t pos = size.load(std::memory_order_relaxed);
+        if (pos == capacity) {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        samples[pos] = sample;
+        size.store(pos + 1, std::memory_order_release);
+    }
+};
+
+// owner of the buffers of all threads
+// the buffers outlive their threads, so the samples of finished threads are kept
+class sample_registry {
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<sample_buffer>> buffers_;
+
+public:
+    static sample_registry& instance() {
+        static sample_registry registry;
+        return registry;
+    }
+
+    sample_buffer* add() {
+        std::lock_guard guard{mutex_};
+        return buffers_.emplace_back(std::make_unique<sample_buffer>()).get();
+    }
+
+    template<typename F>
+    void for_each(F&& fn) {
+        std::lock_guard guard{mutex_};
+        for (const auto& buffer : buffers_) {
+            fn(*buffer);
+        }
+    }
+};
+
+inline std::atomic<std::uint32_t> sample_period{1024};
+inline thread_local std::uint32_t sample_countdown = 0;
+inline thread_local sample_buffer* local_buffer = nullptr;
+
+// the slow path, kept out of line so the return address is the call site
+[[gnu::noinline]] inline void record_dispatch(const std::type_info& base, const std::type_info& dynamic) {
+    if (!local_buffer) {
+        local_buffer = sample_registry::instance().add();
+    }
+    local_buffer->push({__builtin_return_address(0), &base, &dynamic});
+}
+
+// empty pointers are not sampled
+template<typename Base>
+[[gnu::always_inline]] inline void sample_dispatch(const Base* object) {
+    if (!object || sample_countdown-- != 0) [[likely]] {
+        return;
+    }
+    sample_countdown = sample_period.load(std::memory_order_relaxed) - 1;
+    if constexpr (std::is_polymorphic_v<Base>) {
+        record_dispatch(typeid(Base), typeid(*object));
+    } else {
+        record_dispatch(typeid(Base), typeid(Base));
+    }
+}
+
+} // namespace _
+
+// sample every `period`-th dereference in each thread, `1` samples all of them
+inline void set_dispatch_sample_period(std::uint32_t period) {
+    _::sample_period.store(std::max<std::uint32_t>(period, 1), std::memory_order_relaxed);
+}
+
+// samples of all threads recorded so far
+inline std::vector<dispatch_sample> collect_dispatch_samples() {
+    std::vector<dispatch_sample> samples;
+    _::sample_registry::instance().for_each([&](const _::sample_buffer& buffer) {
+        const std::size_t size = buffer.size.load(std::memory_order_acquire);
+        samples.insert(samples.end(), buffer.samples, buffer.samples + size);
+    });
+    return samples;
+}
+
+// number of samples dropped because of full buffers
+inline std::size_t dropped_dispatch_samples() {
+    std::size_t dropped = 0;
+    _::sample_registry::instance().for_each([&](const _::sample_buffer& buffer) {
+        dropped += buffer.dropped.load(std::memory_order_relaxed);
+    });
+    return dropped;
+}
+
+// no thread may sample concurrently
+inline void clear_dispatch_samples() {
+    _::sample_registry::instance().for_each([](_::sample_buffer& buffer) {
+        buffer.size.store(0, std::memory_order_relaxed);
+        buffer.dropped.store(0, std::memory_order_relaxed);
+    });
+}
+
+// samples of a call site
+struct dispatch_site_report {
+    const void* site;
+    // name of the function containing the site, empty if it's unknown
+    std::string symbol;
+    const std::type_info* base;
+    std::size_t samples;
+    // Shannon entropy of the dynamic types in bits,
+    // `0` for a monomorphic site, `log2(k)` for `k` evenly mixed types
+    double entropy;
+    // dynamic types with their sample counts, the most frequent first
+    std::vector<std::pair<const std::type_info*, std::size_t>> types;
+};
+
+// aggregate the samples per call site, the hottest sites first
+inline std::vector<dispatch_site_report> dispatch_report(const std::vector<dispatch_sample>& samples) {
+    std::map<const void*, dispatch_site_report> sites;
+    std::map<std::pair<const void*, const std::type_info*>, std::size_t> counts;
+    for (const auto& sample : samples) {
+        auto& site = sites.try_emplace(sample.site, dispatch_site_report{sample.site, {}, sample.base, 0, 0.0, {}}).first->second;
+        ++site.samples;
+        ++counts[{sample.site, sample.dynamic}];
+    }
+    for (const auto& [key, count] : counts) {
+        sites.at(key.first).types.emplace_back(key.second, count);
+    }
+
+    std::vector<dispatch_site_report> report;
+    for (auto& [address, site] : sites) {
+        std::sort(site.types.begin(), site.types.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second > rhs.second;
+        });
+        for (const auto& [type, count] : site.types) {
+            const double p = static_cast<double>(count) / static_cast<double>(site.samples);
+            site.entropy -= p * std::log2(p);
+        }
+#if __has_include(<dlfcn.h>)
+        Dl_info info;
+        if (::dladdr(address, &info) && info.dli_sname) {
+            site.symbol = info.dli_sname;
+        }
+#endif
+        report.push_back(std::move(site));
+    }
+    std::sort(report.begin(), report.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.samples > rhs.samples;
+    });
+    return report;
+}
+
+inline std::vector<dispatch_site_report> dispatch_report() {
+    return dispatch_report(collect_dispatch_samples());
+}
+
+// human-readable report, one block per call site
+// the addresses can be resolved with `addr2line`
+inline void print_dispatch_report(std::ostream& out, const std::vector<dispatch_site_report>& report) {
+    for (const auto& site : report) {
+        // formatted apart, so the state of `out` isn't changed
+        std::ostringstream entropy;
+        entropy << std::fixed << std::setprecision(3) << site.entropy;
+        out << site.site;
+        if (!site.symbol.empty()) {
+            out << " in " << site.symbol;
+        }
+        out << " base " << site.base->name()
+            << " samples " << site.samples
+            << " entropy " << entropy.str() << '\n';
+        for (const auto& [type, count] : site.types) {
+            out << "    " << type->name() << ' ' << count << '\n';
+        }
+    }
+}
+
+} // namespace sp
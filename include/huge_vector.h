@@ -0,0 +1,216 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#else
+#include <cstdlib>
+#endif
+
+namespace sp {
+
+namespace _ {
+
+static constexpr std::size_t small_page_size = 4 * 1024;
+static constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+// round the mapping up to whole pages
+// big mappings are rounded to hugepages so that the tail is hugepage-backed too
+inline std::size_t page_round(std::size_t bytes) {
+    const std::size_t page = bytes >= huge_page_size ? huge_page_size : small_page_size;
+    return (bytes + page - 1) / page * page;
+}
+
+#if defined(__linux__)
+
+inline void advise_huge_pages(void* ptr, std::size_t bytes) {
+#if defined(MADV_HUGEPAGE)
+    if (bytes >= huge_page_size) {
+        // the call fails if the kernel has no transparent hugepages,
+        // the memory is still usable with regular pages then
+        ::madvise(ptr, bytes, MADV_HUGEPAGE);
+    }
+#endif
+}
+
+inline void* map_pages(std::size_t bytes) {
+    void* ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        throw std::bad_alloc{};
+    }
+    advise_huge_pages(ptr, bytes);
+    return ptr;
+}
+
+// the kernel moves page table entries instead of copying the memory
+inline void* remap_pages(void* ptr, std::size_t old_bytes, std::size_t new_bytes) {
+    void* new_ptr = ::mremap(ptr, old_bytes, new_bytes, MREMAP_MAYMOVE);
+    if (new_ptr == MAP_FAILED) {
+        throw std::bad_alloc{};
+    }
+    advise_huge_pages(new_ptr, new_bytes);
+    return new_ptr;
+}
+
+inline void unmap_pages(void* ptr, std::size_t bytes) noexcept {
+    ::munmap(ptr, bytes);
+}
+
+#else
+
+// fallback for platforms without mmap/mremap
+inline void* map_pages(std::size_t bytes) {
+    void* ptr = std::malloc(bytes);
+    if (!ptr) {
+        throw std::bad_alloc{};
+    }
+    return ptr;
+}
+
+inline void* remap_pages(void* ptr, std::size_t /* old_bytes */, std::size_t new_bytes) {
+    void* new_ptr = std::realloc(ptr, new_bytes);
+    if (!new_ptr) {
+        throw std::bad_alloc{};
+    }
+    return new_ptr;
+}
+
+inline void unmap_pages(void* ptr, std::size_t /* bytes */) noexcept {
+    std::free(ptr);
+}
+
+#endif
+
+} // namespace _
+
+// vector for very large arrays of trivially relocatable objects (for example,
+// static_ptr's holding trivially relocatable types)
+// the memory is page-mapped and hugepage-backed when possible, growing
+// relocates the whole array at once instead of moving element by element
+template<typename T>
+requires(is_trivially_relocatable_v<T>)
+class huge_vector {
+private:
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not supported");
+
+    T* data_;
+    std::size_t size_;
+    std::size_t capacity_;
+    // size of the mapping in bytes
+    std::size_t bytes_;
+
+    void grow(std::size_t min_capacity) {
+        const std::size_t new_bytes = _::page_round(std::max(min_capacity, 2 * capacity_) * sizeof(T));
+        void* new_data = data_
+            ? _::remap_pages(data_, bytes_, new_bytes)
+            : _::map_pages(new_bytes);
+        data_ = static_cast<T*>(new_data);
+        bytes_ = new_bytes;
+        capacity_ = new_bytes / sizeof(T);
+    }
+
+    void release() noexcept {
+        if (data_) {
+            _::unmap_pages(data_, bytes_);
+        }
+        data_ = nullptr;
+        size_ = capacity_ = bytes_ = 0;
+    }
+
+public:
+    // operators, ctors, dtor
+    huge_vector() noexcept : data_{nullptr}, size_{0}, capacity_{0}, bytes_{0} {}
+
+    explicit huge_vector(std::size_t capacity) : huge_vector{} {
+        reserve(capacity);
+    }
+
+    huge_vector(huge_vector&& rhs) noexcept
+        : data_{std::exchange(rhs.data_, nullptr)}
+        , size_{std::exchange(rhs.size_, 0)}
+        , capacity_{std::exchange(rhs.capacity_, 0)}
+        , bytes_{std::exchange(rhs.bytes_, 0)}
+    {}
+
+    huge_vector& operator=(huge_vector&& rhs) noexcept {
+        if (this != &rhs) {
+            clear();
+            release();
+            data_ = std::exchange(rhs.data_, nullptr);
+            size_ = std::exchange(rhs.size_, 0);
+            capacity_ = std::exchange(rhs.capacity_, 0);
+            bytes_ = std::exchange(rhs.bytes_, 0);
+        }
+        return *this;
+    }
+
+    huge_vector(const huge_vector&) = delete;
+    huge_vector& operator=(const huge_vector&) = delete;
+
+    ~huge_vector() {
+        clear();
+        release();
+    }
+
+    // modifiers
+    // `args` must not refer to the vector's own elements, growing may relocate them
+    template<typename ...Args>
+    T& emplace_back(Args&&... args) {
+        if (size_ == capacity_) {
+            grow(size_ + 1);
+        }
+        T* elem = new (data_ + size_) T(std::forward<Args>(args)...);
+        ++size_;
+        return *elem;
+    }
+
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+    void pop_back() noexcept {
+        --size_;
+        data_[size_].~T();
+    }
+
+    void clear() noexcept {
+        for (std::size_t i = 0; i < size_; ++i) {
+            data_[i].~T();
+        }
+        size_ = 0;
+    }
+
+    void reserve(std::size_t capacity) {
+        if (capacity > capacity_) {
+            grow(capacity);
+        }
+    }
+
+    // accessors
+    T& operator[](std::size_t pos) noexcept { return data_[pos]; }
+    const T& operator[](std::size_t pos) const noexcept { return data_[pos]; }
+
+    T& back() noexcept { return data_[size_ - 1]; }
+    const T& back() const noexcept { return data_[size_ - 1]; }
+
+    T* data() noexcept { return data_; }
+    const T* data() const noexcept { return data_; }
+
+    std::size_t size() const noexcept { return size_; }
+    std::size_t capacity() const noexcept { return capacity_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    // iterators
+    T* begin() noexcept { return data_; }
+    T* end() noexcept { return data_ + size_; }
+    const T* begin() const noexcept { return data_; }
+    const T* end() const noexcept { return data_ + size_; }
+};
+
+} // namespace sp
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace sp {
+
+// hash and equality hooks for interned types
+// specialize it for types without `std::hash` or `operator==`
+template<typename T>
+struct intern_traits {
+    static std::size_t hash(const T& value) {
+        return std::hash<T>{}(value);
+    }
+
+    static bool equal(const T& lhs, const T& rhs) {
+        return lhs == rhs;
+    }
+};
+
+namespace _ {
+
+// intern ops struct definition
+// extends `ops` with the hooks of `intern_traits`
+struct intern_ops {
+    using hash_func_type = std::size_t(*)(const void* value);
+    using equal_func_type = bool(*)(const void* lhs, const void* rhs);
+
+    ops_ptr ops;
+    hash_func_type hash_func;
+    equal_func_type equal_func;
+};
+
+template<typename T>
+std::size_t hash_func(const void* value) {
+    return intern_traits<T>::hash(*static_cast<const T*>(value));
+}
+
+template<typename T>
+bool equal_func(const void* lhs, const void* rhs) {
+    return intern_traits<T>::equal(*static_cast<const T*>(lhs), *static_cast<const T*>(rhs));
+}
+
+template<typename T>
+inline constexpr intern_ops intern_ops_for{
+    .ops = &ops_for<T>,
+    .hash_func = &hash_func<T>,
+    .equal_func = &equal_func<T>,
+};
+
+} // namespace _
+
+// compact handle to an interned value
+// handles are equal iff the values are equal
+template<typename Base>
+class interned {
+private:
+    template<typename T, std::size_t> friend class intern_table;
+
+    static constexpr std::uint32_t npos = static_cast<std::uint32_t>(-1);
+
+    std::uint32_t index_;
+
+    explicit interned(std::uint32_t index) noexcept : index_{index} {}
+
+public:
+    interned() noexcept : index_{npos} {}
+
+    std::uint32_t index() const noexcept { return index_; }
+
+    operator bool() const noexcept { return index_ != npos; }
+
+    bool operator==(const interned& rhs) const noexcept = default;
+};
+
+// interning table for immutable polymorphic objects
+// each distinct value is stored once inline in a slab of slots
+// lookups take a shared lock, dereferencing a handle takes no lock at all
+template<typename Base, std::size_t MaxChunks = 4096>
+class intern_table {
+private:
+    static constexpr std::size_t buffer_size = static_ptr_traits<Base>::buffer_size;
+    static constexpr std::size_t align = alignof(std::max_align_t);
+    static constexpr std::size_t chunk_size = 1024;
+
+    struct slot {
+        const _::intern_ops* ops;
+        std::aligned_storage_t<buffer_size, align> buf;
+    };
+
+    struct chunk {
+        slot slots[chunk_size];
+    };
+
+    template<typename Derived>
+    struct derived_class_check {
+        static constexpr bool ok = sizeof(Derived) <= buffer_size && std::is_base_of_v<Base, Derived>;
+    };
+
+    // fixed-size directory, so that readers never see it reallocated
+    std::unique_ptr<std::atomic<chunk*>[]> chunks_;
+    std::atomic<std::uint32_t> size_;
+    // hash of the value to the slot index
+    std::unordered_multimap<std::size_t, std::uint32_t> index_;
+    mutable std::shared_mutex mutex_;
+
+    slot& at(std::uint32_t index) const noexcept {
+        chunk* c = chunks_[index / chunk_size].load(std::memory_order_acquire);
+        return c->slots[index % chunk_size];
+    }
+
+    // must be called under `mutex_`
+    interned<Base> find(std::size_t hash, const _::intern_ops* ops, const void* value) const {
+        const auto [first, last] = index_.equal_range(hash);
+        for (auto it = first; it != last; ++it) {
+            const slot& s = at(it->second);
+            if (s.ops == ops && (ops->equal_func)(&s.buf, value)) {
+                return interned<Base>{it->second};
+            }
+        }
+        return {};
+    }
+
+public:
+    intern_table()
+        : chunks_{new std::atomic<chunk*>[MaxChunks]}
+        , size_{0}
+    {
+        for (std::size_t i = 0; i < MaxChunks; ++i) {
+            chunks_[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    intern_table(const intern_table&) = delete;
+    intern_table& operator=(const intern_table&) = delete;
+
+    ~intern_table() {
+        const std::uint32_t size = size_.load(std::memory_order_relaxed);
+        for (std::uint32_t i = 0; i < size; ++i) {
+            slot& s = at(i);
+            _::destruct(&s.buf, s.ops->ops);
+        }
+        for (std::size_t i = 0; i < MaxChunks; ++i) {
+            delete chunks_[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    // get the handle to the value equal to `Derived(args...)`, the value
+    // is stored if it isn't interned yet
+    template<typename Derived = Base, typename ...Args>
+    interned<Base> intern(Args&&... args)
+        requires(derived_class_check<Derived>::ok)
+    {
+        const _::intern_ops* ops = &_::intern_ops_for<Derived>;
+        Derived value(std::forward<Args>(args)...);
+        // values of different types with equal hashes are not mixed up
+        const std::size_t hash = intern_traits<Derived>::hash(value) ^ reinterpret_cast<std::uintptr_t>(ops);
+
+        {
+            std::shared_lock guard{mutex_};
+            if (auto handle = find(hash, ops, &value)) {
+                return handle;
+            }
+        }
+
+        std::unique_lock guard{mutex_};
+        // the value could be interned while the lock was released
+        if (auto handle = find(hash, ops, &value)) {
+            return handle;
+        }
+
+        const std::uint32_t index = size_.load(std::memory_order_relaxed);
+        if (index / chunk_size >= MaxChunks) {
+            throw std::length_error("sp::intern_table is full");
+        }
+        if (!chunks_[index / chunk_size].load(std::memory_order_relaxed)) {
+            chunks_[index / chunk_size].store(new chunk, std::memory_order_release);
+        }
+
+        // the slot is indexed only once it holds the object, so a throwing
+        // constructor leaves nothing behind
+        slot& s = at(index);
+        new (&s.buf) Derived(std::move(value));
+        s.ops = ops;
+        try {
+            index_.emplace(hash, index);
+        } catch (...) {
+            _::destruct(&s.buf, ops->ops);
+            throw;
+        }
+        size_.store(index + 1, std::memory_order_release);
+        return interned<Base>{index};
+    }
+
+    // accessors
+    // the handle must have been returned by this table
+    const Base& operator[](interned<Base> handle) const noexcept {
+        return *reinterpret_cast<const Base*>(&at(handle.index()).buf);
+    }
+
+    // number of distinct values
+    std::size_t size() const noexcept {
+        return size_.load(std::memory_order_acquire);
+    }
+};
+
+} // namespace sp
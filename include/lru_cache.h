@@ -0,0 +1,245 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sp {
+
+// LRU cache with inline polymorphic values
+// the entries live in a slot array allocated once, the recency list and the
+// hash index refer to them by 32-bit indices, so nothing is allocated per insert
+// the cache is bounded by the number of entries and by the bytes of the
+// values, counted as the sizes of their types
+template<typename Key, typename Base, typename Hash = std::hash<Key>, std::size_t BufferSize = 0>
+class lru_cache {
+private:
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    struct entry {
+        // equals to `std::nullopt` for free entries
+        std::optional<Key> key;
+        std::uint64_t hash = 0;
+        std::size_t bytes = 0;
+        static_ptr<Base, BufferSize> value;
+        // recency links, the free entries are linked by `next`
+        std::uint32_t prev = npos;
+        std::uint32_t next = npos;
+    };
+
+    Hash hash_;
+    std::vector<entry> entries_;
+    // open addressing index of the entries, twice as large as the entries
+    std::vector<std::uint32_t> index_;
+    std::size_t max_bytes_;
+    std::size_t size_ = 0;
+    std::size_t bytes_ = 0;
+    // the most and the least recently used entries
+    std::uint32_t head_ = npos;
+    std::uint32_t tail_ = npos;
+    std::uint32_t free_ = npos;
+
+    std::uint64_t hash(const Key& key) const {
+        return static_cast<std::uint64_t>(hash_(key)) * 0x9E3779B97F4A7C15ull;
+    }
+
+    std::size_t home(std::uint64_t h) const noexcept {
+        return (h >> 32) & (index_.size() - 1);
+    }
+
+    // position in the index of the key, or of the empty bucket for it
+    std::size_t find(const Key& key, std::uint64_t h) const {
+        const std::size_t mask = index_.size() - 1;
+        for (std::size_t i = home(h);; i = (i + 1) & mask) {
+            const std::uint32_t e = index_[i];
+            if (e == npos || (entries_[e].hash == h && *entries_[e].key == key)) {
+                return i;
+            }
+        }
+    }
+
+    // remove the bucket, shifting the following buckets back, so that
+    // the index needs no tombstones
+    void unindex(std::size_t pos) noexcept {
+        const std::size_t mask = index_.size() - 1;
+        std::size_t i = pos;
+        for (std::size_t j = (pos + 1) & mask; index_[j] != npos; j = (j + 1) & mask) {
+            const std::size_t k = home(entries_[index_[j]].hash);
+            // the entry can't move before its home bucket
+            const bool stays = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+            if (!stays) {
+                index_[i] = index_[j];
+                i = j;
+            }
+        }
+        index_[i] = npos;
+    }
+
+    void unlink(std::uint32_t e) noexcept {
+        entry& en = entries_[e];
+        (en.prev == npos ? head_ : entries_[en.prev].next) = en.next;
+        (en.next == npos ? tail_ : entries_[en.next].prev) = en.prev;
+        en.prev = en.next = npos;
+    }
+
+    void link_front(std::uint32_t e) noexcept {
+        entry& en = entries_[e];
+        en.prev = npos;
+        en.next = head_;
+        (head_ == npos ? tail_ : entries_[head_].prev) = e;
+        head_ = e;
+    }
+
+    // destruct the value and return the entry to the free list
+    // the entry must be unlinked and unindexed
+    void release(std::uint32_t e) noexcept(std::is_nothrow_destructible_v<Base>) {
+        entry& en = entries_[e];
+        en.key.reset();
+        bytes_ -= en.bytes;
+        en.bytes = 0;
+        --size_;
+        en.next = free_;
+        free_ = e;
+        en.value.reset();
+    }
+
+    void remove(std::size_t pos) noexcept(std::is_nothrow_destructible_v<Base>) {
+        const std::uint32_t e = index_[pos];
+        unindex(pos);
+        unlink(e);
+        release(e);
+    }
+
+    void evict() noexcept(std::is_nothrow_destructible_v<Base>) {
+        remove(find(*entries_[tail_].key, entries_[tail_].hash));
+    }
+
+public:
+    // `capacity` entries at most, whose values take `max_bytes` at most
+    explicit lru_cache(std::size_t capacity, std::size_t max_bytes = std::numeric_limits<std::size_t>::max(), Hash hash = {})
+        : hash_{std::move(hash)}
+        , entries_(capacity)
+        , index_(std::bit_ceil(std::max<std::size_t>(2 * capacity, 2)), npos)
+        , max_bytes_{max_bytes}
+    {
+        if (capacity == 0 || capacity >= npos) {
+            throw std::invalid_argument("sp::lru_cache: invalid capacity");
+        }
+        for (std::size_t i = capacity; i-- > 0;) {
+            entries_[i].next = free_;
+            free_ = static_cast<std::uint32_t>(i);
+        }
+    }
+
+    lru_cache(const lru_cache&) = delete;
+    lru_cache& operator=(const lru_cache&) = delete;
+
+    ~lru_cache() {
+        clear();
+    }
+
+    // construct the value of the key in place, replacing the old value
+    // the least recently used entries are evicted to make room
+    // the old value is gone if the constructor throws
+    template<typename Derived = Base, typename ...Args>
+    Derived& emplace(const Key& key, Args&&... args) {
+        if (sizeof(Derived) > max_bytes_) {
+            throw std::length_error("sp::lru_cache: the value is larger than the cache");
+        }
+        const std::uint64_t h = hash(key);
+        if (const std::size_t pos = find(key, h); index_[pos] != npos) {
+            remove(pos);
+        }
+        while (size_ == entries_.size() || bytes_ + sizeof(Derived) > max_bytes_) {
+            evict();
+        }
+
+        const std::uint32_t e = free_;
+        entry& en = entries_[e];
+        // the entry stays free if the key copy or the constructor throws
+        en.key.emplace(key);
+        Derived* value;
+        try {
+            value = &en.value.template emplace<Derived>(std::forward<Args>(args)...);
+        } catch (...) {
+            en.key.reset();
+            throw;
+        }
+        free_ = en.next;
+        en.hash = h;
+        en.bytes = sizeof(Derived);
+        bytes_ += en.bytes;
+        ++size_;
+        index_[find(key, h)] = e;
+        link_front(e);
+        return *value;
+    }
+
+    // the value of the key, which becomes the most recently used one
+    // returns `nullptr` if the key is absent
+    Base* get(const Key& key) {
+        const std::uint32_t e = index_[find(key, hash(key))];
+        if (e == npos) {
+            return nullptr;
+        }
+        if (e != head_) {
+            unlink(e);
+            link_front(e);
+        }
+        return entries_[e].value.get();
+    }
+
+    // the value of the key without changing the recency
+    const Base* peek(const Key& key) const {
+        const std::uint32_t e = index_[find(key, hash(key))];
+        return e == npos ? nullptr : entries_[e].value.get();
+    }
+
+    bool contains(const Key& key) const {
+        return peek(key) != nullptr;
+    }
+
+    bool erase(const Key& key) {
+        const std::size_t pos = find(key, hash(key));
+        if (index_[pos] == npos) {
+            return false;
+        }
+        remove(pos);
+        return true;
+    }
+
+    void clear() noexcept(std::is_nothrow_destructible_v<Base>) {
+        while (head_ != npos) {
+            evict();
+        }
+    }
+
+    // accessors
+    std::size_t size() const noexcept { return size_; }
+    std::size_t capacity() const noexcept { return entries_.size(); }
+    bool empty() const noexcept { return size_ == 0; }
+
+    // bytes taken by the values
+    std::size_t bytes() const noexcept { return bytes_; }
+    std::size_t max_bytes() const noexcept { return max_bytes_; }
+
+    // call `fn(const Key&, Base&)` from the most to the least recently used entry
+    template<typename F>
+    void for_each(F&& fn) {
+        for (std::uint32_t e = head_; e != npos; e = entries_[e].next) {
+            fn(*entries_[e].key, *entries_[e].value);
+        }
+    }
+};
+
+} // namespace sp
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sp {
+
+// 32-bit handle to a node of a node_arena
+template<typename Base>
+class node_handle {
+private:
+    template<typename T, std::size_t> friend class node_arena;
+
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    std::uint32_t index_;
+
+    explicit node_handle(std::uint32_t index) noexcept : index_{index} {}
+
+public:
+    node_handle() noexcept : index_{npos} {}
+
+    std::uint32_t index() const noexcept { return index_; }
+
+    operator bool() const noexcept { return index_ != npos; }
+
+    bool operator==(const node_handle& rhs) const noexcept = default;
+};
+
+// forest of polymorphic nodes stored inline in a contiguous arena
+// the tree links are 32-bit indices kept next to the nodes, so the nodes
+// need no pointers to each other; the whole forest is released at once
+template<typename Base, std::size_t BufferSize = 0>
+class node_arena {
+public:
+    using handle = node_handle<Base>;
+    using node_ptr = static_ptr<Base, BufferSize>;
+
+private:
+    static constexpr std::uint32_t npos = handle::npos;
+
+    struct slot {
+        node_ptr node;
+        std::uint32_t parent = npos;
+        std::uint32_t first_child = npos;
+        std::uint32_t last_child = npos;
+        std::uint32_t next_sibling = npos;
+    };
+
+    std::vector<slot> slots_;
+    std::uint32_t first_root_ = npos;
+    std::uint32_t last_root_ = npos;
+
+    // append a slot as the last child of `parent` (a root for `npos`)
+    std::uint32_t link(std::uint32_t parent) {
+        if (slots_.size() >= npos) {
+            throw std::length_error("sp::node_arena: too many nodes");
+        }
+        const auto index = static_cast<std::uint32_t>(slots_.size());
+        slots_.emplace_back().parent = parent;
+        std::uint32_t& first = parent == npos ? first_root_ : slots_[parent].first_child;
+        std::uint32_t& last = parent == npos ? last_root_ : slots_[parent].last_child;
+        if (last == npos) {
+            first = index;
+        } else {
+            slots_[last].next_sibling = index;
+        }
+        last = index;
+        return index;
+    }
+
+    // undo `link` of the slots from `mark` on and destruct them
+    // the new slots are walked once, the old parents get back their old last children
+    void rollback(std::size_t mark) noexcept(std::is_nothrow_destructible_v<Base>) {
+        for (std::size_t i = mark; i < slots_.size(); ++i) {
+            const std::uint32_t parent = slots_[i].parent;
+            if (parent != npos && parent >= mark) {
+                // the parent is dropped too
+                continue;
+            }
+            std::uint32_t& first = parent == npos ? first_root_ : slots_[parent].first_child;
+            std::uint32_t& last = parent == npos ? last_root_ : slots_[parent].last_child;
+            if (last == npos || last < mark) {
+                // already restored by a previous sibling
+                continue;
+            }
+            if (first >= mark) {
+                first = last = npos;
+            } else {
+                // the children are linked in the order of indices
+                std::uint32_t prev = first;
+                while (slots_[prev].next_sibling < mark) {
+                    prev = slots_[prev].next_sibling;
+                }
+                slots_[prev].next_sibling = npos;
+                last = prev;
+            }
+        }
+        slots_.resize(mark);
+    }
+
+public:
+    node_arena() = default;
+
+    node_arena(node_arena&& rhs) noexcept
+        : slots_{std::move(rhs.slots_)}
+        , first_root_{std::exchange(rhs.first_root_, npos)}
+        , last_root_{std::exchange(rhs.last_root_, npos)}
+    {}
+
+    node_arena& operator=(node_arena&& rhs) noexcept(std::is_nothrow_destructible_v<Base>) {
+        if (this != &rhs) {
+            slots_ = std::move(rhs.slots_);
+            rhs.slots_.clear();
+            first_root_ = std::exchange(rhs.first_root_, npos);
+            last_root_ = std::exchange(rhs.last_root_, npos);
+        }
+        return *this;
+    }
+
+    // modifiers
+    // construct a node as the last child of `parent`, a root for an empty handle
+    template<typename Derived = Base, typename ...Args>
+    handle add(handle parent, Args&&... args) {
+        const std::uint32_t index = link(parent.index_);
+        try {
+            slots_[index].node.template emplace<Derived>(std::forward<Args>(args)...);
+        } catch (...) {
+            rollback(index);
+            throw;
+        }
+        return handle{index};
+    }
+
+    // add a batch of nodes at once
+    // `parents[i]` is the index of the parent of the i-th node within the
+    // batch, it must be less than `i`, or `no_parent()` for a root;
+    // `make(node_ptr&, i)` constructs the i-th node in place
+    // returns the handle of the first node of the batch, the nodes keep their order
+    template<typename F>
+    handle build(std::span<const std::uint32_t> parents, F&& make) {
+        const std::size_t first = slots_.size();
+        for (std::size_t i = 0; i < parents.size(); ++i) {
+            if (parents[i] != npos && parents[i] >= i) {
+                throw std::invalid_argument("sp::node_arena: a parent must precede its children");
+            }
+        }
+        slots_.reserve(first + parents.size());
+        try {
+            for (std::size_t i = 0; i < parents.size(); ++i) {
+                const std::uint32_t parent = parents[i] == npos ? npos : static_cast<std::uint32_t>(first + parents[i]);
+                const std::uint32_t index = link(parent);
+                make(slots_[index].node, i);
+            }
+        } catch (...) {
+            rollback(first);
+            throw;
+        }
+        return parents.empty() ? handle{} : handle{static_cast<std::uint32_t>(first)};
+    }
+
+    // reorder the nodes in depth-first pre-order, so that a traversal walks
+    // the arena sequentially and the first child of a node follows it
+    // all handles are invalidated, returns the new index of each old index
+    std::vector<std::uint32_t> relayout() {
+        std::vector<std::uint32_t> order;
+        order.reserve(slots_.size());
+        for_each_depth_first([&](handle h) { order.push_back(h.index_); });
+
+        std::vector<std::uint32_t> remap(slots_.size());
+        for (std::uint32_t i = 0; i < order.size(); ++i) {
+            remap[order[i]] = i;
+        }
+        auto map = [&](std::uint32_t index) { return index == npos ? npos : remap[index]; };
+
+        std::vector<slot> slots(slots_.size());
+        for (std::uint32_t i = 0; i < order.size(); ++i) {
+            slot& src = slots_[order[i]];
+            slot& dst = slots[i];
+            dst.node = std::move(src.node);
+            dst.parent = map(src.parent);
+            dst.first_child = map(src.first_child);
+            dst.last_child = map(src.last_child);
+            dst.next_sibling = map(src.next_sibling);
+        }
+        slots_ = std::move(slots);
+        first_root_ = map(first_root_);
+        last_root_ = map(last_root_);
+        return remap;
+    }
+
+    // release all the nodes at once, keeping the memory
+    void clear() noexcept(std::is_nothrow_destructible_v<Base>) {
+        slots_.clear();
+        first_root_ = last_root_ = npos;
+    }
+
+    void reserve(std::size_t capacity) {
+        slots_.reserve(capacity);
+    }
+
+    // accessors
+    Base& operator[](handle h) noexcept { return *slots_[h.index_].node; }
+    const Base& operator[](handle h) const noexcept { return *slots_[h.index_].node; }
+
+    handle parent(handle h) const noexcept { return handle{slots_[h.index_].parent}; }
+    handle first_child(handle h) const noexcept { return handle{slots_[h.index_].first_child}; }
+    handle next_sibling(handle h) const noexcept { return handle{slots_[h.index_].next_sibling}; }
+    handle first_root() const noexcept { return handle{first_root_}; }
+
+    // the parent index of a root in `build`
+    static constexpr std::uint32_t no_parent() noexcept { return npos; }
+
+    std::size_t size() const noexcept { return slots_.size(); }
+    bool empty() const noexcept { return slots_.empty(); }
+
+    // call `fn(handle)` for the children of a node
+    template<typename F>
+    void for_each_child(handle h, F&& fn) const {
+        for (std::uint32_t i = slots_[h.index_].first_child; i != npos; i = slots_[i].next_sibling) {
+            fn(handle{i});
+        }
+    }
+
+    // call `fn(handle)` for all the nodes in depth-first pre-order
+    // after `relayout` it's a sequential walk over the arena
+    template<typename F>
+    void for_each_depth_first(F&& fn) const {
+        std::uint32_t i = first_root_;
+        while (i != npos) {
+            fn(handle{i});
+            if (slots_[i].first_child != npos) {
+                i = slots_[i].first_child;
+                continue;
+            }
+            // climb up to the first ancestor with a next sibling
+            while (i != npos && slots_[i].next_sibling == npos) {
+                i = slots_[i].parent;
+            }
+            if (i != npos) {
+                i = slots_[i].next_sibling;
+            }
+        }
+    }
+};
+
+} // namespace sp
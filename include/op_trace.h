@@ -0,0 +1,253 @@
+#pragma once
+
+// recorder of the operations on static_ptr objects
+// it is compiled in only if STATIC_PTR_TRACE is defined before including
+// `static_ptr.h`, all translation units must agree on it
+//
+// while the recording is started, every emplace, move, dereference and reset
+// appends a 12-byte record to a single process-wide trace, the pointers are
+// numbered by their addresses and the types by the order of first emplace
+// the trace keeps the order of operations across threads by taking a mutex,
+// so this mode is meant for capture runs rather than for production
+// the trace can be saved and replayed by the benchmark
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+namespace sp {
+
+enum class trace_op : std::uint8_t {
+    // `type` was constructed in `slot`
+    emplace,
+    // the object was moved from `source` to `slot`
+    move,
+    // the object in `slot` was dereferenced
+    dispatch,
+    // the object in `slot` was destructed
+    // the last one, the values above it are rejected by `op_trace::read`
+    reset,
+};
+
+struct trace_record {
+    std::uint32_t slot;
+    std::uint32_t source;
+    std::uint16_t type;
+    trace_op op;
+};
+
+struct trace_type {
+    std::uint32_t size;
+    std::string name;
+};
+
+struct op_trace {
+    std::vector<trace_type> types;
+    std::vector<trace_record> records;
+    // number of distinct pointers, the slots are below it
+    std::uint32_t slots = 0;
+
+    // binary format, native byte order
+    void write(std::ostream& out) const {
+        auto put = [&](const void* data, std::size_t size) {
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        };
+        const std::uint32_t header[] = {magic, slots, static_cast<std::uint32_t>(types.size())};
+        put(header, sizeof(header));
+        for (const auto& type : types) {
+            const std::uint32_t fields[] = {type.size, static_cast<std::uint32_t>(type.name.size())};
+            put(fields, sizeof(fields));
+            put(type.name.data(), type.name.size());
+        }
+        const std::uint64_t size = records.size();
+        put(&size, sizeof(size));
+        // the fields are written one by one, the padding is zeroed
+        std::vector<char> bytes(records.size() * record_size, 0);
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            char* out = bytes.data() + i * record_size;
+            std::memcpy(out + offsetof(trace_record, slot), &records[i].slot, sizeof(trace_record::slot));
+            std::memcpy(out + offsetof(trace_record, source), &records[i].source, sizeof(trace_record::source));
+            std::memcpy(out + offsetof(trace_record, type), &records[i].type, sizeof(trace_record::type));
+            std::memcpy(out + offsetof(trace_record, op), &records[i].op, sizeof(trace_record::op));
+        }
+        put(bytes.data(), bytes.size());
+    }
+
+    static op_trace read(std::istream& in) {
+        auto get = [&](void* data, std::size_t size) {
+            if (!in.read(static_cast<char*>(data), static_cast<std::streamsize>(size))) {
+                throw std::invalid_argument("sp::op_trace: truncated trace");
+            }
+        };
+        op_trace trace;
+        std::uint32_t header[3];
+        get(header, sizeof(header));
+        if (header[0] != magic) {
+            throw std::invalid_argument("sp::op_trace: not a trace");
+        }
+        trace.slots = header[1];
+        trace.types.resize(header[2]);
+        for (auto& type : trace.types) {
+            std::uint32_t fields[2];
+            get(fields, sizeof(fields));
+            type.size = fields[0];
+            type.name.resize(fields[1]);
+            get(type.name.data(), type.name.size());
+        }
+        std::uint64_t size;
+        get(&size, sizeof(size));
+        trace.records.resize(size);
+        get(trace.records.data(), trace.records.size() * sizeof(trace_record));
+        for (const auto& record : trace.records) {
+            const bool ok = static_cast<std::uint8_t>(record.op) <= static_cast<std::uint8_t>(trace_op::reset)
+                && record.slot < trace.slots
+                && (record.op != trace_op::move || record.source < trace.slots)
+                && (record.op != trace_op::emplace || record.type < trace.types.size());
+            if (!ok) {
+                throw std::invalid_argument("sp::op_trace: bad record");
+            }
+        }
+        return trace;
+    }
+
+private:
+    static constexpr std::uint32_t magic = 0x52545053;
+    // the records are read back as they are laid out in memory
+    static constexpr std::size_t record_size = 12;
+    static_assert(sizeof(trace_record) == record_size);
+};
+
+namespace _ {
+
+class trace_recorder {
+private:
+    std::mutex mutex_;
+    std::unordered_map<const void*, std::uint32_t> slots_;
+    std::unordered_map<std::type_index, std::uint16_t> types_;
+    op_trace trace_;
+
+    // must be called under `mutex_`
+    std::uint32_t slot(const void* ptr) {
+        const auto [it, inserted] = slots_.try_emplace(ptr, trace_.slots);
+        trace_.slots += inserted;
+        return it->second;
+    }
+
+public:
+    static trace_recorder& instance() {
+        static trace_recorder recorder;
+        return recorder;
+    }
+
+    // throws if the type doesn't fit into the 16-bit field of the records
+    void emplace(const void* ptr, const std::type_info& type, std::size_t size) {
+        std::lock_guard guard{mutex_};
+        auto it = types_.find(type);
+        if (it == types_.end()) {
+            if (trace_.types.size() > std::numeric_limits<std::uint16_t>::max()) {
+                throw std::length_error("sp::op_trace: too many types");
+            }
+            it = types_.emplace(type, static_cast<std::uint16_t>(trace_.types.size())).first;
+            try {
+                trace_.types.push_back({static_cast<std::uint32_t>(size), type.name()});
+            } catch (...) {
+                types_.erase(it);
+                throw;
+            }
+        }
+        trace_.records.push_back({slot(ptr), 0, it->second, trace_op::emplace});
+    }
+
+    void record(trace_op op, const void* ptr, const void* source = nullptr) {
+        std::lock_guard guard{mutex_};
+        const std::uint32_t dst = slot(ptr);
+        trace_.records.push_back({dst, source ? slot(source) : 0, 0, op});
+    }
+
+    op_trace collect() {
+        std::lock_guard guard{mutex_};
+        return trace_;
+    }
+
+    void clear() {
+        std::lock_guard guard{mutex_};
+        slots_.clear();
+        types_.clear();
+        trace_ = {};
+    }
+};
+
+inline std::atomic<bool> trace_enabled{false};
+inline std::atomic<std::size_t> trace_dropped{0};
+
+// the hooks of static_ptr, the slow paths are kept out of line
+// they are called from noexcept functions, so a record that can't be
+// allocated is dropped
+[[gnu::noinline]] inline void record_emplace(const void* ptr, const std::type_info& type, std::size_t size) noexcept {
+    try {
+        trace_recorder::instance().emplace(ptr, type, size);
+    } catch (...) {
+        trace_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+[[gnu::noinline]] inline void record_op(trace_op op, const void* ptr, const void* source = nullptr) noexcept {
+    try {
+        trace_recorder::instance().record(op, ptr, source);
+    } catch (...) {
+        trace_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+template<typename Derived>
+inline void trace_emplace(const void* ptr) noexcept {
+    if (trace_enabled.load(std::memory_order_relaxed)) [[unlikely]] {
+        record_emplace(ptr, typeid(Derived), sizeof(Derived));
+    }
+}
+
+inline void trace(trace_op op, const void* ptr, const void* source = nullptr) noexcept {
+    if (trace_enabled.load(std::memory_order_relaxed)) [[unlikely]] {
+        record_op(op, ptr, source);
+    }
+}
+
+} // namespace _
+
+inline void start_op_trace() {
+    _::trace_enabled.store(true, std::memory_order_relaxed);
+}
+
+inline void stop_op_trace() {
+    _::trace_enabled.store(false, std::memory_order_relaxed);
+}
+
+// operations recorded so far
+inline op_trace collect_op_trace() {
+    return _::trace_recorder::instance().collect();
+}
+
+// number of records dropped because they couldn't be allocated, or because
+// their type was over the limit of 65536 types
+inline std::size_t dropped_op_trace_records() {
+    return _::trace_dropped.load(std::memory_order_relaxed);
+}
+
+// the slots and types are numbered anew after it
+inline void clear_op_trace() {
+    _::trace_recorder::instance().clear();
+    _::trace_dropped.store(0, std::memory_order_relaxed);
+}
+
+} // namespace sp
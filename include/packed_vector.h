@@ -0,0 +1,245 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sp {
+
+// contiguous polymorphic storage with stable indices
+// erasing leaves a tombstone in O(1), iteration skips tombstones using a
+// bitmap of live slots, and holes are closed incrementally by `compact`
+template<typename Base>
+class packed_vector {
+private:
+    using word_type = std::uint64_t;
+    static constexpr std::size_t word_bits = 64;
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    std::vector<static_ptr<Base>> slots_;
+    // bit `i` is set if `slots_[i]` is live
+    std::vector<word_type> live_;
+    // number of live slots
+    std::size_t size_;
+
+    // state of the current compaction pass
+    // all slots in [compact_write_, compact_read_) are tombstones
+    bool compacting_;
+    std::size_t compact_write_;
+    std::size_t compact_read_;
+
+    void set_live(std::size_t index) noexcept {
+        live_[index / word_bits] |= word_type{1} << (index % word_bits);
+    }
+
+    void clear_live(std::size_t index) noexcept {
+        live_[index / word_bits] &= ~(word_type{1} << (index % word_bits));
+    }
+
+    // first slot at `index` or after it with the bit equal to `live`
+    std::size_t find(std::size_t index, bool live) const noexcept {
+        while (index < slots_.size()) {
+            word_type word = live_[index / word_bits];
+            if (!live) {
+                word = ~word;
+            }
+            word >>= index % word_bits;
+            if (word) {
+                index += std::countr_zero(word);
+                return index < slots_.size() ? index : npos;
+            }
+            index = (index / word_bits + 1) * word_bits;
+        }
+        return npos;
+    }
+
+    std::size_t append(static_ptr<Base>&& ptr) {
+        const std::size_t index = slots_.size();
+        if (index % word_bits == 0) {
+            live_.push_back(0);
+        }
+        slots_.push_back(std::move(ptr));
+        set_live(index);
+        ++size_;
+        return index;
+    }
+
+    void truncate(std::size_t new_size) {
+        slots_.resize(new_size);
+        live_.resize((new_size + word_bits - 1) / word_bits);
+    }
+
+public:
+    // iterator over live objects
+    template<bool Const>
+    class basic_iterator {
+    private:
+        using owner_type = std::conditional_t<Const, const packed_vector, packed_vector>;
+
+        owner_type* owner_;
+        std::size_t index_;
+
+        friend class packed_vector;
+
+        basic_iterator(owner_type* owner, std::size_t index) noexcept : owner_{owner}, index_{index} {}
+
+    public:
+        using value_type = Base;
+        using reference = std::conditional_t<Const, const Base&, Base&>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        basic_iterator() noexcept : owner_{nullptr}, index_{npos} {}
+
+        // index of the current slot
+        std::size_t index() const noexcept { return index_; }
+
+        reference operator*() const noexcept { return *owner_->slots_[index_]; }
+        auto* operator->() const noexcept { return owner_->slots_[index_].get(); }
+
+        basic_iterator& operator++() noexcept {
+            index_ = owner_->find(index_ + 1, true);
+            return *this;
+        }
+
+        basic_iterator operator++(int) noexcept {
+            basic_iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const basic_iterator& rhs) const noexcept { return index_ == rhs.index_; }
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    // operators, ctors, dtor
+    packed_vector() noexcept
+        : size_{0}
+        , compacting_{false}
+        , compact_write_{0}
+        , compact_read_{0}
+    {}
+
+    packed_vector(packed_vector&& rhs) noexcept
+        : slots_{std::move(rhs.slots_)}
+        , live_{std::move(rhs.live_)}
+        , size_{std::exchange(rhs.size_, 0)}
+        , compacting_{std::exchange(rhs.compacting_, false)}
+        , compact_write_{std::exchange(rhs.compact_write_, 0)}
+        , compact_read_{std::exchange(rhs.compact_read_, 0)}
+    {}
+
+    packed_vector& operator=(packed_vector&& rhs) noexcept(std::is_nothrow_destructible_v<Base>) {
+        if (this != &rhs) {
+            slots_ = std::move(rhs.slots_);
+            live_ = std::move(rhs.live_);
+            size_ = std::exchange(rhs.size_, 0);
+            compacting_ = std::exchange(rhs.compacting_, false);
+            compact_write_ = std::exchange(rhs.compact_write_, 0);
+            compact_read_ = std::exchange(rhs.compact_read_, 0);
+            // the moved-from vectors are left in a valid but unspecified state
+            rhs.slots_.clear();
+            rhs.live_.clear();
+        }
+        return *this;
+    }
+
+    // modifiers
+    // new objects are always appended, returns the index of the slot
+    template<typename Derived = Base, typename ...Args>
+    std::size_t emplace(Args&&... args) {
+        static_ptr<Base> ptr;
+        ptr.template emplace<Derived>(std::forward<Args>(args)...);
+        return append(std::move(ptr));
+    }
+
+    std::size_t push_back(static_ptr<Base>&& ptr) {
+        return append(std::move(ptr));
+    }
+
+    // destruct the object and leave a tombstone in O(1)
+    void erase(std::size_t index) noexcept(std::is_nothrow_destructible_v<Base>) {
+        slots_[index].reset();
+        clear_live(index);
+        --size_;
+    }
+
+    void clear() noexcept(std::is_nothrow_destructible_v<Base>) {
+        slots_.clear();
+        live_.clear();
+        size_ = 0;
+        compacting_ = false;
+    }
+
+    // relocate at most `max_moves` objects into the holes before them,
+    // preserving their order; `on_move(from, to)` is called for each
+    // relocated object so that external indices can be updated
+    // returns the number of relocated objects
+    template<typename OnMove>
+    std::size_t compact(std::size_t max_moves, OnMove&& on_move) {
+        if (!compacting_) {
+            compact_write_ = find(0, false);
+            if (compact_write_ == npos) {
+                // no holes
+                return 0;
+            }
+            compact_read_ = compact_write_;
+            compacting_ = true;
+        }
+
+        std::size_t moves = 0;
+        while (moves < max_moves) {
+            compact_read_ = find(compact_read_, true);
+            if (compact_read_ == npos) {
+                // everything after `compact_write_` is a tombstone
+                truncate(compact_write_);
+                compacting_ = false;
+                break;
+            }
+            slots_[compact_write_] = std::move(slots_[compact_read_]);
+            set_live(compact_write_);
+            clear_live(compact_read_);
+            on_move(compact_read_, compact_write_);
+            ++compact_write_;
+            ++compact_read_;
+            ++moves;
+        }
+        return moves;
+    }
+
+    std::size_t compact(std::size_t max_moves) {
+        return compact(max_moves, [](std::size_t, std::size_t) {});
+    }
+
+    // accessors
+    // `index` must refer to a live slot
+    Base& operator[](std::size_t index) noexcept { return *slots_[index]; }
+    const Base& operator[](std::size_t index) const noexcept { return *slots_[index]; }
+
+    bool contains(std::size_t index) const noexcept {
+        return index < slots_.size() && (live_[index / word_bits] >> (index % word_bits)) & 1;
+    }
+
+    // number of live objects
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    // number of slots, including tombstones
+    std::size_t slot_count() const noexcept { return slots_.size(); }
+    std::size_t tombstone_count() const noexcept { return slots_.size() - size_; }
+
+    // iterators
+    iterator begin() noexcept { return {this, find(0, true)}; }
+    iterator end() noexcept { return {this, npos}; }
+    const_iterator begin() const noexcept { return {this, find(0, true)}; }
+    const_iterator end() const noexcept { return {this, npos}; }
+};
+
+} // namespace sp
@@ -0,0 +1,304 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sp {
+
+// pipeline stage interface
+// a stage processes a whole batch per call, `out` has the same size as `in`
+// all the stages share the element type, so they are stored in one array and
+// their batches are handed through the same queues
+// a stage is never called concurrently with itself, so it may keep state
+template<typename T>
+class pipeline_stage {
+public:
+    virtual ~pipeline_stage() = default;
+    virtual void process(std::span<const T> in, std::span<T> out) = 0;
+};
+
+// executor options
+struct pipeline_options {
+    // number of worker threads
+    std::size_t threads = 1;
+    // number of elements in a batch
+    std::size_t batch_size = 256;
+    // maximal number of batches waiting in front of a stage
+    std::size_t queue_capacity = 4;
+};
+
+// dataflow pipeline of inline-stored stages wired into a DAG
+// batches are handed between stages through bounded queues and processed
+// by a thread pool; a stage whose successors have full queues isn't run,
+// so the backpressure reaches the producer in `push`
+// the sink gets the output of every terminal stage, its calls are serialized,
+// so it needn't be thread-safe; the order is kept along a chain, but batches
+// of different terminal stages, as well as the inputs of a stage with
+// several predecessors, arrive in an unspecified order
+// the first exception thrown by a stage or the sink stops the pipeline,
+// the queued batches are dropped and `finish` rethrows it
+// stages are stored in buffers of `StageSize` bytes (`0` means the size from traits)
+template<typename T, std::size_t StageSize = 0>
+class pipeline {
+public:
+    using sink_type = std::function<void(std::span<const T>)>;
+
+private:
+    using batch = std::vector<T>;
+    using stage_type = pipeline_stage<T>;
+
+    struct node {
+        static_ptr<stage_type, StageSize> stage;
+        std::vector<std::size_t> successors;
+        std::size_t predecessors = 0;
+        std::deque<batch> queue;
+        // batches in flight from the predecessors, they have a reserved place in `queue`
+        std::size_t reserved = 0;
+        bool running = false;
+    };
+
+    const pipeline_options options_;
+    sink_type sink_;
+    std::vector<node> nodes_;
+    std::vector<std::thread> workers_;
+    // the producer's current batch
+    batch pending_;
+
+    std::mutex mutex_;
+    // serializes the calls of `sink_`, which are made out of `mutex_`
+    std::mutex sink_mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable space_cv_;
+    // number of batches queued or being processed
+    std::size_t in_flight_ = 0;
+    bool stopping_ = false;
+    // the first exception of a stage or the sink
+    std::exception_ptr error_;
+
+    bool has_space(const node& n) const {
+        return n.queue.size() + n.reserved < options_.queue_capacity;
+    }
+
+    // a node can run if it has input and all its successors have space for its output
+    bool runnable(const node& n) const {
+        if (n.running || n.queue.empty()) {
+            return false;
+        }
+        for (std::size_t succ : n.successors) {
+            if (!has_space(nodes_[succ])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // must be called under `mutex_`
+    node* pick() {
+        for (auto& n : nodes_) {
+            if (runnable(n)) {
+                return &n;
+            }
+        }
+        return nullptr;
+    }
+
+    void work() {
+        std::unique_lock lock{mutex_};
+        while (true) {
+            node* n = nullptr;
+            work_cv_.wait(lock, [&] { return stopping_ || (n = pick()) != nullptr; });
+            if (!n) {
+                return;
+            }
+
+            batch in = std::move(n->queue.front());
+            n->queue.pop_front();
+            n->running = true;
+            for (std::size_t succ : n->successors) {
+                ++nodes_[succ].reserved;
+            }
+            space_cv_.notify_all();
+
+            lock.unlock();
+            batch out;
+            std::exception_ptr error;
+            try {
+                out.resize(in.size());
+                n->stage->process(in, out);
+                if (n->successors.empty() && sink_) {
+                    std::lock_guard sink_guard{sink_mutex_};
+                    sink_(out);
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+
+            n->running = false;
+            for (std::size_t i = 0; i < n->successors.size(); ++i) {
+                node& succ = nodes_[n->successors[i]];
+                --succ.reserved;
+                if (!error) {
+                    // the last successor takes the batch, the others copy it
+                    succ.queue.push_back(i + 1 < n->successors.size() ? out : std::move(out));
+                    ++in_flight_;
+                }
+            }
+            --in_flight_;
+            if (error) {
+                if (!error_) {
+                    error_ = std::move(error);
+                }
+                stopping_ = true;
+            }
+            work_cv_.notify_all();
+            space_cv_.notify_all();
+        }
+    }
+
+    // hand a batch to the entry stages, blocks while their queues are full
+    // the batch is dropped if the pipeline has failed
+    void submit(batch&& b) {
+        std::unique_lock lock{mutex_};
+        space_cv_.wait(lock, [&] {
+            if (error_) {
+                return true;
+            }
+            for (const auto& n : nodes_) {
+                if (n.predecessors == 0 && !has_space(n)) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        if (error_) {
+            return;
+        }
+        node* last = nullptr;
+        for (auto& n : nodes_) {
+            if (n.predecessors == 0) {
+                if (last) {
+                    last->queue.push_back(b);
+                    ++in_flight_;
+                }
+                last = &n;
+            }
+        }
+        if (last) {
+            last->queue.push_back(std::move(b));
+            ++in_flight_;
+        }
+        work_cv_.notify_all();
+    }
+
+public:
+    explicit pipeline(pipeline_options options = {}, sink_type sink = {})
+        : options_{options}
+        , sink_{std::move(sink)}
+    {
+        if (options_.threads == 0 || options_.batch_size == 0 || options_.queue_capacity == 0) {
+            throw std::invalid_argument("sp::pipeline: the number of threads, the batch size and the queue capacity must be positive");
+        }
+    }
+
+    pipeline(const pipeline&) = delete;
+    pipeline& operator=(const pipeline&) = delete;
+
+    // the exception of a failed pipeline is lost unless `finish` is called
+    ~pipeline() {
+        try {
+            finish();
+        } catch (...) {
+        }
+    }
+
+    // building the graph, only before `start`
+    // returns the stage id
+    template<typename Derived, typename ...Args>
+    std::size_t add_stage(Args&&... args) {
+        auto& n = nodes_.emplace_back();
+        n.stage.template emplace<Derived>(std::forward<Args>(args)...);
+        return nodes_.size() - 1;
+    }
+
+    // the stages must be added in a topological order, so `from < to`
+    void connect(std::size_t from, std::size_t to) {
+        if (from >= to || to >= nodes_.size()) {
+            throw std::invalid_argument("sp::pipeline: stages must be connected in the order of addition");
+        }
+        nodes_[from].successors.push_back(to);
+        ++nodes_[to].predecessors;
+    }
+
+    // start the worker threads
+    void start() {
+        for (std::size_t i = 0; i < options_.threads; ++i) {
+            workers_.emplace_back([this] { work(); });
+        }
+    }
+
+    // feeding the data, only after `start`
+    void push(const T& value) {
+        if (workers_.empty()) {
+            throw std::logic_error("sp::pipeline: push before start");
+        }
+        pending_.push_back(value);
+        if (pending_.size() >= options_.batch_size) {
+            flush();
+        }
+    }
+
+    void push(std::span<const T> values) {
+        for (const auto& value : values) {
+            push(value);
+        }
+    }
+
+    // hand the incomplete batch to the pipeline
+    void flush() {
+        if (!pending_.empty()) {
+            submit(std::exchange(pending_, {}));
+        }
+    }
+
+    // process all the data and stop the worker threads
+    // rethrows the exception of a failed pipeline, which can be restarted then
+    // nothing is queued before `start`, so there's nothing to process then
+    void finish() {
+        if (workers_.empty()) {
+            return;
+        }
+        flush();
+        {
+            std::unique_lock lock{mutex_};
+            space_cv_.wait(lock, [&] { return in_flight_ == 0 || error_; });
+            stopping_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+        stopping_ = false;
+        if (error_) {
+            for (auto& n : nodes_) {
+                n.queue.clear();
+            }
+            in_flight_ = 0;
+            std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+    }
+};
+
+} // namespace sp
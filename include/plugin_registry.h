@@ -0,0 +1,391 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <dlfcn.h>
+
+// defines the entry point of a plugin, `load` calls it to collect the plugin's types:
+//
+//   STATIC_PTR_PLUGIN(IStrategy, registrar) {
+//       registrar.add<TMomentum>(0x1001, "momentum");
+//   }
+//
+// plugins should be built with hidden visibility, otherwise the loader may
+// refuse to unmap them
+#define STATIC_PTR_PLUGIN(Base, registrar)                                    \
+    extern "C" __attribute__((visibility("default")))                         \
+    void sp_register_plugin(::sp::plugin_registrar<Base>& registrar)
+
+namespace sp {
+
+// descriptor of a plugin type, filled in by the plugin
+struct plugin_type_info {
+    // stable ID chosen by the plugin, `0` is reserved
+    std::uint64_t id;
+    std::string name;
+    std::size_t size;
+    std::size_t align;
+    // the ops table and the default constructor inside the plugin
+    _::ops_ptr ops;
+    void (*construct_func)(void* buf);
+};
+
+namespace _ {
+
+template<typename T>
+void default_construct_func(void* buf) {
+    new (buf) T();
+}
+
+} // namespace _
+
+// collector of the types of a plugin while its entry point runs
+// the descriptors are processed after the entry point returns, so that no
+// code of the registry is instantiated inside the plugin
+template<typename Base>
+class plugin_registrar {
+private:
+    template<typename, std::size_t> friend class plugin_registry;
+
+    std::vector<plugin_type_info> types_;
+
+    plugin_registrar() = default;
+
+public:
+    template<typename Derived>
+    void add(std::uint64_t id, std::string_view name)
+        requires(std::is_base_of_v<Base, Derived> && std::is_default_constructible_v<Derived>)
+    {
+        types_.push_back({
+            .id = id,
+            .name = std::string{name},
+            .size = sizeof(Derived),
+            .align = alignof(Derived),
+            .ops = &_::ops_for<Derived>,
+            .construct_func = &_::default_construct_func<Derived>,
+        });
+    }
+};
+
+// shared object loaded by a registry
+// the records are kept by the registry until it is destroyed
+class plugin_module {
+private:
+    template<typename, std::size_t> friend class plugin_registry;
+
+    std::string path_;
+    void* handle_;
+    // objects of the plugin's types, including the ones being constructed
+    std::atomic<std::size_t> live_{0};
+    std::atomic<bool> retired_{false};
+    std::atomic<bool> closed_{false};
+
+public:
+    plugin_module(std::string path, void* handle) : path_{std::move(path)}, handle_{handle} {}
+
+    const std::string& path() const noexcept { return path_; }
+
+    std::size_t live_objects() const noexcept { return live_.load(std::memory_order_acquire); }
+
+    // whether the shared object is still open
+    bool loaded() const noexcept { return !closed_.load(std::memory_order_acquire); }
+};
+
+// registry of polymorphic types defined in dlopen-loaded plugins
+// each type gets a compact index that is stable for its ID during the
+// process lifetime, the lookups and constructions take no lock
+//
+// static_ptr holding a plugin object points to an ops table of the registry,
+// which counts the objects around the calls into the plugin, so the plugin
+// is closed only after the last of its objects is destructed
+// the registry of each `Base` is a singleton, because these ops tables are
+// plain functions which find their type by its index
+template<typename Base, std::size_t MaxTypes = 64>
+class plugin_registry {
+    static_assert(std::has_single_bit(MaxTypes), "MaxTypes must be a power of two");
+
+public:
+    static constexpr std::uint32_t npos = static_cast<std::uint32_t>(-1);
+
+private:
+    struct type_slot {
+        // `0` for a free slot, an ID is never removed once set, so the
+        // probe sequences of the other IDs stay valid
+        std::atomic<std::uint64_t> id{0};
+        // the module of the registered type, `nullptr` once it's retired
+        std::atomic<plugin_module*> published{nullptr};
+        // written before `published`, kept until the slot is reused
+        plugin_module* owner = nullptr;
+        plugin_type_info info{};
+        // the ops table of static_ptr holding the type
+        _::ops ops{};
+    };
+
+    type_slot slots_[MaxTypes];
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<plugin_module>> modules_;
+
+    plugin_registry() = default;
+
+    // the ops of the slots, the counter is changed outside the plugin's code
+    template<std::size_t Index>
+    static void move_construct_func(void* dst, void* src) {
+        type_slot& slot = instance().slots_[Index];
+        slot.owner->live_.fetch_add(1, std::memory_order_relaxed);
+        try {
+            (*slot.info.ops->move_construct_func)(dst, src);
+        } catch (...) {
+            slot.owner->live_.fetch_sub(1, std::memory_order_release);
+            throw;
+        }
+    }
+
+    template<std::size_t Index>
+    static void copy_construct_func(void* dst, void* src) {
+        type_slot& slot = instance().slots_[Index];
+        slot.owner->live_.fetch_add(1, std::memory_order_relaxed);
+        try {
+            (*slot.info.ops->copy_construct_func)(dst, src);
+        } catch (...) {
+            slot.owner->live_.fetch_sub(1, std::memory_order_release);
+            throw;
+        }
+    }
+
+    template<std::size_t Index>
+    static void destruct_func(void* buf) {
+        type_slot& slot = instance().slots_[Index];
+        if (!slot.info.ops->trivially_destructible) {
+            (*slot.info.ops->destruct_func)(buf);
+        }
+        // the destructor has returned, so the plugin may be closed from now on
+        slot.owner->live_.fetch_sub(1, std::memory_order_release);
+    }
+
+    template<std::size_t ...I>
+    static constexpr auto make_slot_ops(std::index_sequence<I...>) {
+        return std::array<_::ops, MaxTypes>{_::ops{
+            .move_construct_func = &move_construct_func<I>,
+            .move_assign_func = nullptr,
+            .destruct_func = &destruct_func<I>,
+            .copy_construct_func = &copy_construct_func<I>,
+            .trivially_destructible = false,
+            .trivially_relocatable = false,
+        }...};
+    }
+
+    static constexpr std::array<_::ops, MaxTypes> slot_ops = make_slot_ops(std::make_index_sequence<MaxTypes>{});
+
+    static std::size_t home(std::uint64_t id) noexcept {
+        return static_cast<std::size_t>((id * 0x9E3779B97F4A7C15ull) >> 32) & (MaxTypes - 1);
+    }
+
+    // must be called under `mutex_`
+    std::size_t claim(std::uint64_t id) {
+        for (std::size_t i = home(id), n = 0; n < MaxTypes; i = (i + 1) & (MaxTypes - 1), ++n) {
+            const std::uint64_t slot_id = slots_[i].id.load(std::memory_order_relaxed);
+            if (slot_id == id) {
+                return i;
+            }
+            if (slot_id == 0) {
+                slots_[i].id.store(id, std::memory_order_release);
+                return i;
+            }
+        }
+        throw std::length_error("sp::plugin_registry is full");
+    }
+
+    // must be called under `mutex_`
+    void publish(plugin_module* module, const plugin_type_info& info) {
+        if (info.id == 0) {
+            throw std::invalid_argument("sp::plugin_registry: the type ID 0 is reserved");
+        }
+        if (info.align > alignof(std::max_align_t)) {
+            throw std::invalid_argument("sp::plugin_registry: over-aligned type " + info.name);
+        }
+        const std::size_t index = claim(info.id);
+        type_slot& slot = slots_[index];
+        if (slot.owner && slot.owner->loaded()) {
+            throw std::invalid_argument("sp::plugin_registry: the ID of " + info.name + " is taken");
+        }
+        // the slot is free, no object refers to its ops
+        slot.owner = module;
+        slot.info = info;
+        slot.ops = slot_ops[index];
+        slot.ops.move_assign_func = info.ops->move_assign_func;
+        if (!info.ops->copy_construct_func) {
+            slot.ops.copy_construct_func = nullptr;
+        }
+        slot.ops.trivially_relocatable = info.ops->trivially_relocatable;
+        slot.published.store(module, std::memory_order_release);
+    }
+
+    // must be called under `mutex_`
+    std::size_t collect_locked() {
+        std::size_t closed = 0;
+        for (const auto& module : modules_) {
+            if (module->retired_.load(std::memory_order_seq_cst) && module->loaded()
+                && module->live_.load(std::memory_order_seq_cst) == 0)
+            {
+                ::dlclose(module->handle_);
+                module->closed_.store(true, std::memory_order_release);
+                ++closed;
+            }
+        }
+        return closed;
+    }
+
+    // must be called under `mutex_`
+    void retire(plugin_module& module) {
+        module.retired_.store(true, std::memory_order_seq_cst);
+        for (auto& slot : slots_) {
+            if (slot.published.load(std::memory_order_relaxed) == &module) {
+                slot.published.store(nullptr, std::memory_order_release);
+            }
+        }
+    }
+
+    const type_slot* slot_of(_::ops_ptr ops) const noexcept {
+        const auto address = reinterpret_cast<std::uintptr_t>(ops);
+        const auto first = reinterpret_cast<std::uintptr_t>(&slots_[0].ops);
+        const auto last = reinterpret_cast<std::uintptr_t>(&slots_[MaxTypes - 1].ops);
+        if (address < first || address > last) {
+            return nullptr;
+        }
+        return &slots_[(address - first) / sizeof(type_slot)];
+    }
+
+public:
+    plugin_registry(const plugin_registry&) = delete;
+    plugin_registry& operator=(const plugin_registry&) = delete;
+
+    // the plugins are never closed at exit, their objects may outlive the registry
+    static plugin_registry& instance() {
+        static plugin_registry registry;
+        return registry;
+    }
+
+    // open the shared object and register the types of its entry point
+    // nothing is registered if one of the types is rejected
+    plugin_module& load(const std::string& path) {
+        std::lock_guard guard{mutex_};
+        void* handle = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            throw std::invalid_argument(std::string{"sp::plugin_registry: "} + ::dlerror());
+        }
+        using entry_func = void(*)(plugin_registrar<Base>&);
+        auto entry = reinterpret_cast<entry_func>(::dlsym(handle, "sp_register_plugin"));
+        if (!entry) {
+            ::dlclose(handle);
+            throw std::invalid_argument("sp::plugin_registry: no entry point in " + path);
+        }
+
+        plugin_module& module = *modules_.emplace_back(std::make_unique<plugin_module>(path, handle));
+        try {
+            plugin_registrar<Base> registrar;
+            entry(registrar);
+            for (const auto& info : registrar.types_) {
+                publish(&module, info);
+            }
+        } catch (...) {
+            retire(module);
+            collect_locked();
+            throw;
+        }
+        return module;
+    }
+
+    // unregister the types of the module, it is closed once none of its objects is left
+    void unload(plugin_module& module) {
+        std::lock_guard guard{mutex_};
+        retire(module);
+        collect_locked();
+    }
+
+    // close the unloaded modules without objects, returns the number of them
+    std::size_t collect() {
+        std::lock_guard guard{mutex_};
+        return collect_locked();
+    }
+
+    // compact index of a registered type, `npos` if the ID isn't registered
+    std::uint32_t index_of(std::uint64_t id) const noexcept {
+        for (std::size_t i = home(id), n = 0; n < MaxTypes; i = (i + 1) & (MaxTypes - 1), ++n) {
+            const std::uint64_t slot_id = slots_[i].id.load(std::memory_order_acquire);
+            if (slot_id == id && id != 0) {
+                return slots_[i].published.load(std::memory_order_acquire) ? static_cast<std::uint32_t>(i) : npos;
+            }
+            if (slot_id == 0) {
+                return npos;
+            }
+        }
+        return npos;
+    }
+
+    // default construct the type of the index in `ptr`
+    // returns `false` if the type isn't registered anymore
+    template<std::size_t BufferSize>
+    bool emplace(std::uint32_t index, static_ptr<Base, BufferSize>& ptr) {
+        if (index >= MaxTypes) {
+            return false;
+        }
+        type_slot& slot = slots_[index];
+        plugin_module* module = slot.published.load(std::memory_order_acquire);
+        if (!module) {
+            return false;
+        }
+        // the module is pinned before its code is called, `unload` sees either
+        // the pin or the module retired here
+        module->live_.fetch_add(1, std::memory_order_seq_cst);
+        if (module->retired_.load(std::memory_order_seq_cst)) {
+            module->live_.fetch_sub(1, std::memory_order_release);
+            return false;
+        }
+        constexpr std::size_t buffer_size = BufferSize ? BufferSize : static_ptr_traits<Base>::buffer_size;
+        if (slot.info.size > buffer_size) {
+            module->live_.fetch_sub(1, std::memory_order_release);
+            throw std::length_error("sp::plugin_registry: " + slot.info.name + " doesn't fit into the buffer");
+        }
+
+        ptr.reset();
+        try {
+            (*slot.info.construct_func)(_::access::buf(ptr));
+        } catch (...) {
+            module->live_.fetch_sub(1, std::memory_order_release);
+            throw;
+        }
+        _::access::ops(ptr) = &slot.ops;
+        return true;
+    }
+
+    // stable ID of the plugin type held by `ptr`, `0` for other types
+    template<std::size_t BufferSize>
+    std::uint64_t id_of(const static_ptr<Base, BufferSize>& ptr) const noexcept {
+        const type_slot* slot = slot_of(_::access::ops(ptr));
+        return slot ? slot->info.id : 0;
+    }
+
+    // name of the plugin type held by `ptr`, empty for other types
+    template<std::size_t BufferSize>
+    std::string_view name_of(const static_ptr<Base, BufferSize>& ptr) const noexcept {
+        const type_slot* slot = slot_of(_::access::ops(ptr));
+        return slot ? std::string_view{slot->info.name} : std::string_view{};
+    }
+};
+
+} // namespace sp
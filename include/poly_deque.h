@@ -0,0 +1,271 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sp {
+
+// deque of polymorphic objects stored inline in fixed-size chunks
+// it grows at both ends without moving the objects, so references and
+// pointers to them stay valid until the objects are removed
+template<typename Base, std::size_t BufferSize = 0, std::size_t ChunkSize = 64>
+class poly_deque {
+private:
+    static_assert(ChunkSize > 0, "chunks must hold at least one object");
+
+    using slot = static_ptr<Base, BufferSize>;
+
+    struct chunk {
+        slot slots[ChunkSize];
+    };
+
+    // chunk directory, `nullptr` for the chunks not allocated yet
+    // the objects are at the positions `[begin_, end_)` counted over the whole directory
+    std::vector<std::unique_ptr<chunk>> map_;
+    std::size_t begin_ = 0;
+    std::size_t end_ = 0;
+    // an emptied chunk is kept, so that pushing and popping at a chunk boundary doesn't allocate
+    std::unique_ptr<chunk> spare_;
+
+    slot& at(std::size_t pos) const noexcept {
+        return map_[pos / ChunkSize]->slots[pos % ChunkSize];
+    }
+
+    // make sure the chunk for the position is allocated
+    slot& reserve_slot(std::size_t pos) {
+        auto& c = map_[pos / ChunkSize];
+        if (!c) {
+            c = spare_ ? std::move(spare_) : std::make_unique<chunk>();
+        }
+        return c->slots[pos % ChunkSize];
+    }
+
+    // the chunk holds no objects anymore
+    void release_chunk(std::size_t index) noexcept {
+        if (!spare_) {
+            spare_ = std::move(map_[index]);
+        } else {
+            map_[index].reset();
+        }
+    }
+
+    template<typename F>
+    void for_each_slot(F&& fn) const {
+        for (std::size_t pos = begin_; pos < end_;) {
+            chunk& c = *map_[pos / ChunkSize];
+            const std::size_t first = pos % ChunkSize;
+            const std::size_t last = std::min(ChunkSize, first + (end_ - pos));
+            for (std::size_t i = first; i < last; ++i) {
+                fn(c.slots[i]);
+            }
+            pos += last - first;
+        }
+    }
+
+    // the directory is shifted instead of grown while at least half of it is
+    // free at the other end, so a deque used as a queue keeps it bounded
+    // the entries outside of the used chunks are `nullptr`, shifting moves
+    // only the chunk pointers, not the objects
+
+    // add room for at least one chunk after the last one
+    void grow_back() {
+        const std::size_t free_front = begin_ / ChunkSize;
+        if (free_front > 0 && 2 * free_front >= map_.size()) {
+            std::move(map_.begin() + free_front, map_.end(), map_.begin());
+            begin_ -= free_front * ChunkSize;
+            end_ -= free_front * ChunkSize;
+        } else {
+            map_.emplace_back();
+        }
+    }
+
+    // add room for at least one chunk before the first one
+    void grow_front() {
+        const std::size_t used_end = (end_ + ChunkSize - 1) / ChunkSize;
+        const std::size_t free_back = map_.size() - used_end;
+        if (free_back > 0 && 2 * free_back >= map_.size()) {
+            std::move_backward(map_.begin(), map_.begin() + used_end, map_.end());
+            begin_ += free_back * ChunkSize;
+            end_ += free_back * ChunkSize;
+            return;
+        }
+        const std::size_t count = std::max<std::size_t>(map_.size(), 1);
+        std::vector<std::unique_ptr<chunk>> map(count);
+        map.insert(map.end(), std::make_move_iterator(map_.begin()), std::make_move_iterator(map_.end()));
+        map_ = std::move(map);
+        begin_ += count * ChunkSize;
+        end_ += count * ChunkSize;
+    }
+
+    template<bool Const>
+    class basic_iterator {
+    private:
+        friend class poly_deque;
+        friend class basic_iterator<!Const>;
+
+        using deque_ptr = std::conditional_t<Const, const poly_deque*, poly_deque*>;
+
+        deque_ptr deque_;
+        std::size_t pos_;
+
+        basic_iterator(deque_ptr deque, std::size_t pos) noexcept : deque_{deque}, pos_{pos} {}
+
+    public:
+        using value_type = Base;
+        using reference = std::conditional_t<Const, const Base&, Base&>;
+        using pointer = std::conditional_t<Const, const Base*, Base*>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        basic_iterator() noexcept : deque_{nullptr}, pos_{0} {}
+
+        // non-const to const conversion
+        template<bool RhsConst>
+        basic_iterator(const basic_iterator<RhsConst>& rhs) noexcept requires(Const && !RhsConst)
+            : deque_{rhs.deque_}, pos_{rhs.pos_}
+        {}
+
+        reference operator*() const noexcept { return *deque_->at(pos_); }
+        pointer operator->() const noexcept { return deque_->at(pos_).get(); }
+
+        basic_iterator& operator++() noexcept {
+            ++pos_;
+            return *this;
+        }
+
+        basic_iterator operator++(int) noexcept {
+            basic_iterator tmp = *this;
+            ++pos_;
+            return tmp;
+        }
+
+        basic_iterator& operator--() noexcept {
+            --pos_;
+            return *this;
+        }
+
+        basic_iterator operator--(int) noexcept {
+            basic_iterator tmp = *this;
+            --pos_;
+            return tmp;
+        }
+
+        bool operator==(const basic_iterator& rhs) const noexcept { return pos_ == rhs.pos_; }
+    };
+
+public:
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    poly_deque() = default;
+
+    poly_deque(poly_deque&& rhs) noexcept
+        : map_{std::move(rhs.map_)}
+        , begin_{std::exchange(rhs.begin_, 0)}
+        , end_{std::exchange(rhs.end_, 0)}
+        , spare_{std::move(rhs.spare_)}
+    {}
+
+    poly_deque& operator=(poly_deque&& rhs) noexcept(std::is_nothrow_destructible_v<Base>) {
+        if (this != &rhs) {
+            clear();
+            map_ = std::move(rhs.map_);
+            rhs.map_.clear();
+            begin_ = std::exchange(rhs.begin_, 0);
+            end_ = std::exchange(rhs.end_, 0);
+            spare_ = std::move(rhs.spare_);
+        }
+        return *this;
+    }
+
+    ~poly_deque() {
+        clear();
+    }
+
+    // modifiers
+    template<typename Derived = Base, typename ...Args>
+    Derived& emplace_back(Args&&... args) {
+        if (end_ == map_.size() * ChunkSize) {
+            grow_back();
+        }
+        auto& derived = reserve_slot(end_).template emplace<Derived>(std::forward<Args>(args)...);
+        ++end_;
+        return derived;
+    }
+
+    template<typename Derived = Base, typename ...Args>
+    Derived& emplace_front(Args&&... args) {
+        if (begin_ == 0) {
+            grow_front();
+        }
+        auto& derived = reserve_slot(begin_ - 1).template emplace<Derived>(std::forward<Args>(args)...);
+        --begin_;
+        return derived;
+    }
+
+    void pop_back() noexcept(std::is_nothrow_destructible_v<Base>) {
+        --end_;
+        at(end_).reset();
+        if (end_ % ChunkSize == 0) {
+            release_chunk(end_ / ChunkSize);
+        }
+    }
+
+    void pop_front() noexcept(std::is_nothrow_destructible_v<Base>) {
+        at(begin_).reset();
+        ++begin_;
+        if (begin_ % ChunkSize == 0 || begin_ == end_) {
+            release_chunk((begin_ - 1) / ChunkSize);
+        }
+    }
+
+    // destruct the objects and release the chunks
+    void clear() noexcept(std::is_nothrow_destructible_v<Base>) {
+        for (std::size_t pos = begin_; pos < end_; ++pos) {
+            at(pos).reset();
+        }
+        map_.clear();
+        spare_.reset();
+        begin_ = end_ = 0;
+    }
+
+    // accessors
+    Base& operator[](std::size_t pos) noexcept { return *at(begin_ + pos); }
+    const Base& operator[](std::size_t pos) const noexcept { return *at(begin_ + pos); }
+
+    Base& front() noexcept { return *at(begin_); }
+    const Base& front() const noexcept { return *at(begin_); }
+    Base& back() noexcept { return *at(end_ - 1); }
+    const Base& back() const noexcept { return *at(end_ - 1); }
+
+    std::size_t size() const noexcept { return end_ - begin_; }
+    bool empty() const noexcept { return begin_ == end_; }
+    // number of entries of the chunk directory, it's bounded by the size
+    std::size_t directory_size() const noexcept { return map_.size(); }
+
+    // call `fn(Base&)` for all the objects, a chunk at a time
+    template<typename F>
+    void for_each(F&& fn) {
+        for_each_slot([&](slot& s) { fn(*s); });
+    }
+
+    template<typename F>
+    void for_each(F&& fn) const {
+        for_each_slot([&](slot& s) { fn(static_cast<const Base&>(*s)); });
+    }
+
+    // iterators
+    iterator begin() noexcept { return {this, begin_}; }
+    iterator end() noexcept { return {this, end_}; }
+    const_iterator begin() const noexcept { return {this, begin_}; }
+    const_iterator end() const noexcept { return {this, end_}; }
+};
+
+} // namespace sp
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sp {
+
+namespace _ {
+
+template<typename Key>
+struct keyed_index {
+    Key key;
+    std::size_t index;
+};
+
+// order-preserving conversion of an integral key to an unsigned one
+template<typename Key>
+auto radix_key(Key key) noexcept {
+    using unsigned_key = std::make_unsigned_t<std::conditional_t<std::is_same_v<Key, bool>, unsigned char, Key>>;
+    auto ukey = static_cast<unsigned_key>(key);
+    if constexpr (std::is_signed_v<Key>) {
+        ukey ^= unsigned_key{1} << (sizeof(Key) * CHAR_BIT - 1);
+    }
+    return ukey;
+}
+
+// stable LSD radix sort by bytes, the passes with a single bucket are skipped
+template<typename Key>
+void radix_sort(std::vector<keyed_index<Key>>& items) {
+    std::vector<keyed_index<Key>> buffer(items.size());
+    for (std::size_t shift = 0; shift < sizeof(Key) * CHAR_BIT; shift += CHAR_BIT) {
+        std::array<std::size_t, 256> counts{};
+        for (const auto& item : items) {
+            ++counts[(radix_key(item.key) >> shift) & 0xFF];
+        }
+        if (std::find(counts.begin(), counts.end(), items.size()) != counts.end()) {
+            continue;
+        }
+        std::size_t offset = 0;
+        for (auto& count : counts) {
+            offset += std::exchange(count, offset);
+        }
+        for (const auto& item : items) {
+            buffer[counts[(radix_key(item.key) >> shift) & 0xFF]++] = item;
+        }
+        items.swap(buffer);
+    }
+}
+
+} // namespace _
+
+// stable sort of a random access container of static_ptr by `key_fn(const Base&)`
+// the keys are extracted once, the (key, index) pairs are sorted (by radix
+// sort for integral keys), then the objects are relocated in one pass
+// following the cycles of the permutation, one move per object plus one per cycle
+// empty pointers are moved to the end
+template<typename Container, typename KeyFn>
+void sort_by_key(Container& container, KeyFn&& key_fn) {
+    using Base = std::remove_cvref_t<decltype(*container[0])>;
+    using Key = std::remove_cvref_t<std::invoke_result_t<KeyFn&, const Base&>>;
+
+    const std::size_t size = container.size();
+    std::vector<_::keyed_index<Key>> items;
+    items.reserve(size);
+    std::vector<std::size_t> empty;
+    for (std::size_t i = 0; i < size; ++i) {
+        if (container[i]) {
+            items.push_back({key_fn(static_cast<const Base&>(*container[i])), i});
+        } else {
+            empty.push_back(i);
+        }
+    }
+
+    if constexpr (std::is_integral_v<Key>) {
+        _::radix_sort(items);
+    } else {
+        std::stable_sort(items.begin(), items.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.key < rhs.key;
+        });
+    }
+
+    // `source[i]` is the current position of the object going to `i`
+    std::vector<std::size_t> source;
+    source.reserve(size);
+    for (const auto& item : items) {
+        source.push_back(item.index);
+    }
+    source.insert(source.end(), empty.begin(), empty.end());
+
+    for (std::size_t i = 0; i < size; ++i) {
+        if (source[i] == i) {
+            continue;
+        }
+        auto tmp = std::move(container[i]);
+        std::size_t j = i;
+        while (source[j] != i) {
+            container[j] = std::move(container[source[j]]);
+            j = std::exchange(source[j], j);
+        }
+        container[j] = std::move(tmp);
+        source[j] = j;
+    }
+}
+
+} // namespace sp
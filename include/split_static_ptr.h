@@ -0,0 +1,327 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sp {
+
+// a derived type declares its cold part as `using cold_type = ...;`
+// the cold part is default constructed and passed to the derived type's
+// constructor as the first argument
+template<typename T>
+concept has_cold_part = requires { typename T::cold_type; };
+
+namespace _ {
+
+// owner of the cold part of a standalone pointer
+// a single pointer has no slot to index a pool by, so its part is allocated
+// on the heap on its own, the address stays stable while the hot part is
+// relocated
+class cold_slot {
+private:
+    ops_ptr ops_;
+    void* ptr_;
+
+public:
+    cold_slot() noexcept : ops_{nullptr}, ptr_{nullptr} {}
+
+    cold_slot(cold_slot&& rhs) noexcept
+        : ops_{std::exchange(rhs.ops_, nullptr)}
+        , ptr_{std::exchange(rhs.ptr_, nullptr)}
+    {}
+
+    cold_slot& operator=(cold_slot&& rhs) noexcept {
+        if (this != &rhs) {
+            reset();
+            ops_ = std::exchange(rhs.ops_, nullptr);
+            ptr_ = std::exchange(rhs.ptr_, nullptr);
+        }
+        return *this;
+    }
+
+    ~cold_slot() {
+        reset();
+    }
+
+    template<typename Cold>
+    Cold& emplace() {
+        static_assert(alignof(Cold) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned cold parts are not supported");
+        reset();
+        void* ptr = ::operator new(sizeof(Cold));
+        try {
+            new (ptr) Cold();
+        } catch (...) {
+            ::operator delete(ptr);
+            throw;
+        }
+        ops_ = &ops_for<Cold>;
+        ptr_ = ptr;
+        return *static_cast<Cold*>(ptr);
+    }
+
+    void reset() noexcept {
+        if (ops_) {
+            destruct(ptr_, ops_);
+            ::operator delete(ptr_);
+            ops_ = nullptr;
+            ptr_ = nullptr;
+        }
+    }
+
+    void* get() const noexcept { return ptr_; }
+};
+
+// side pool of cold parts indexed by the slot of their hot parts
+// the parts are stored with a stride of `ColdSize` bytes in blocks of
+// `BlockSlots` slots; the blocks are never moved, since a hot part may keep
+// a pointer to its cold part
+template<std::size_t ColdSize, std::size_t BlockSlots = 64>
+class cold_pool {
+private:
+    static constexpr std::size_t align = alignof(std::max_align_t);
+
+    struct block {
+        std::aligned_storage_t<ColdSize, align> bufs[BlockSlots];
+        // equals to `nullptr` for a free slot
+        ops_ptr ops[BlockSlots] = {};
+    };
+
+    std::vector<std::unique_ptr<block>> blocks_;
+
+    block& block_of(std::size_t slot) const noexcept { return *blocks_[slot / BlockSlots]; }
+
+public:
+    // view of a single slot, used by `split_emplace`
+    class slot_ref {
+    private:
+        cold_pool* pool_;
+        std::size_t slot_;
+
+    public:
+        slot_ref(cold_pool& pool, std::size_t slot) noexcept : pool_{&pool}, slot_{slot} {}
+
+        template<typename Cold>
+        Cold& emplace() { return pool_->template emplace<Cold>(slot_); }
+
+        void reset() noexcept { pool_->reset(slot_); }
+    };
+
+    static constexpr std::size_t stride = sizeof(std::aligned_storage_t<ColdSize, align>);
+
+    cold_pool() = default;
+    cold_pool(cold_pool&&) noexcept = default;
+
+    cold_pool& operator=(cold_pool&& rhs) noexcept {
+        if (this != &rhs) {
+            clear();
+            blocks_ = std::move(rhs.blocks_);
+            rhs.blocks_.clear();
+        }
+        return *this;
+    }
+
+    ~cold_pool() {
+        clear();
+    }
+
+    // allocate the blocks for the slots below `slots`
+    void reserve(std::size_t slots) {
+        while (blocks_.size() * BlockSlots < slots) {
+            blocks_.push_back(std::make_unique<block>());
+        }
+    }
+
+    template<typename Cold>
+    Cold& emplace(std::size_t slot) {
+        static_assert(sizeof(Cold) <= ColdSize, "the cold part doesn't fit into ColdSize");
+        static_assert(alignof(Cold) <= align, "over-aligned cold parts are not supported");
+        reserve(slot + 1);
+        reset(slot);
+        block& b = block_of(slot);
+        auto* cold = new (&b.bufs[slot % BlockSlots]) Cold();
+        b.ops[slot % BlockSlots] = &ops_for<Cold>;
+        return *cold;
+    }
+
+    void reset(std::size_t slot) noexcept {
+        if (slot / BlockSlots >= blocks_.size()) {
+            return;
+        }
+        block& b = block_of(slot);
+        if (ops_ptr& ops = b.ops[slot % BlockSlots]) {
+            destruct(&b.bufs[slot % BlockSlots], ops);
+            ops = nullptr;
+        }
+    }
+
+    // destruct all parts, the blocks are kept
+    void clear() noexcept {
+        for (auto& b : blocks_) {
+            for (std::size_t i = 0; i < BlockSlots; ++i) {
+                if (b->ops[i]) {
+                    destruct(&b->bufs[i], b->ops[i]);
+                    b->ops[i] = nullptr;
+                }
+            }
+        }
+    }
+
+    void* get(std::size_t slot) const noexcept { return &block_of(slot).bufs[slot % BlockSlots]; }
+};
+
+// construct the hot part in `hot` and the cold part (if any) in `cold`
+template<typename Derived, typename Hot, typename Cold, typename ...Args>
+Derived& split_emplace(Hot& hot, Cold&& cold, Args&&... args) {
+    hot.reset();
+    cold.reset();
+    if constexpr (has_cold_part<Derived>) {
+        auto& cold_part = cold.template emplace<typename Derived::cold_type>();
+        try {
+            return hot.template emplace<Derived>(cold_part, std::forward<Args>(args)...);
+        } catch (...) {
+            cold.reset();
+            throw;
+        }
+    } else {
+        return hot.template emplace<Derived>(std::forward<Args>(args)...);
+    }
+}
+
+} // namespace _
+
+// smart pointer for objects split into a hot part and a cold part
+// the hot part is stored inline in a buffer of `HotSize` bytes, the cold
+// part (declared by the derived type) lives outside of it; a standalone
+// pointer allocates it on the heap, `split_vector` keeps it in a side pool
+template<typename Base, std::size_t HotSize>
+class split_static_ptr {
+private:
+    static_ptr<Base, HotSize> hot_;
+    _::cold_slot cold_;
+
+public:
+    // operators, ctors, dtor
+    split_static_ptr() noexcept = default;
+    split_static_ptr(std::nullptr_t) noexcept {}
+
+    split_static_ptr(split_static_ptr&&) = default;
+    // the hot part is destructed before its cold part
+    split_static_ptr& operator=(split_static_ptr&&) = default;
+
+    split_static_ptr& operator=(std::nullptr_t) noexcept(std::is_nothrow_destructible_v<Base>) {
+        reset();
+        return *this;
+    }
+
+    ~split_static_ptr() {
+        reset();
+    }
+
+    // in-place (re)initialization
+    template<typename Derived = Base, typename ...Args>
+    Derived& emplace(Args&&... args) {
+        return _::split_emplace<Derived>(hot_, cold_, std::forward<Args>(args)...);
+    }
+
+    // destruct the underlying object
+    void reset() noexcept(std::is_nothrow_destructible_v<Base>) {
+        hot_.reset();
+        cold_.reset();
+    }
+
+    // accessors
+    Base* get() noexcept { return hot_.get(); }
+    const Base* get() const noexcept { return hot_.get(); }
+
+    Base& operator*() noexcept { return *get(); }
+    const Base& operator*() const noexcept { return *get(); }
+
+    Base* operator->() noexcept { return get(); }
+    const Base* operator->() const noexcept { return get(); }
+
+    operator bool() const noexcept { return static_cast<bool>(hot_); }
+
+    // cold part of the object, which must be of type `Derived`
+    template<has_cold_part Derived>
+    typename Derived::cold_type& cold() const noexcept {
+        return *static_cast<typename Derived::cold_type*>(cold_.get());
+    }
+};
+
+// vector of split objects
+// the hot parts are stored densely, and the cold parts of up to `ColdSize`
+// bytes live in a parallel side pool indexed by the slot, so iteration
+// touches only the hot data and there is no allocation per object
+template<typename Base, std::size_t HotSize, std::size_t ColdSize>
+class split_vector {
+private:
+    using hot_slot = static_ptr<Base, HotSize>;
+    using cold_pool = _::cold_pool<ColdSize>;
+
+    std::vector<hot_slot> hot_;
+    cold_pool cold_;
+
+public:
+    split_vector() = default;
+    split_vector(split_vector&&) = default;
+    split_vector& operator=(split_vector&&) = default;
+
+    ~split_vector() {
+        clear();
+    }
+
+    // modifiers
+    template<typename Derived = Base, typename ...Args>
+    Derived& emplace_back(Args&&... args) {
+        const std::size_t pos = hot_.size();
+        hot_.emplace_back();
+        try {
+            return _::split_emplace<Derived>(hot_.back(), typename cold_pool::slot_ref{cold_, pos}, std::forward<Args>(args)...);
+        } catch (...) {
+            hot_.pop_back();
+            throw;
+        }
+    }
+
+    void pop_back() noexcept(std::is_nothrow_destructible_v<Base>) {
+        hot_.pop_back();
+        cold_.reset(hot_.size());
+    }
+
+    void clear() noexcept(std::is_nothrow_destructible_v<Base>) {
+        hot_.clear();
+        cold_.clear();
+    }
+
+    void reserve(std::size_t capacity) {
+        hot_.reserve(capacity);
+        cold_.reserve(capacity);
+    }
+
+    // accessors
+    Base& operator[](std::size_t pos) noexcept { return *hot_[pos]; }
+    const Base& operator[](std::size_t pos) const noexcept { return *hot_[pos]; }
+
+    // cold part of the object at `pos`, which must be of type `Derived`
+    template<has_cold_part Derived>
+    typename Derived::cold_type& cold(std::size_t pos) const noexcept {
+        return *static_cast<typename Derived::cold_type*>(cold_.get(pos));
+    }
+
+    std::size_t size() const noexcept { return hot_.size(); }
+    bool empty() const noexcept { return hot_.empty(); }
+
+    // iterators over the hot slots
+    auto begin() noexcept { return hot_.begin(); }
+    auto end() noexcept { return hot_.end(); }
+    auto begin() const noexcept { return hot_.begin(); }
+    auto end() const noexcept { return hot_.end(); }
+};
+
+} // namespace sp
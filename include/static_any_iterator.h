@@ -0,0 +1,278 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace sp {
+
+namespace _ {
+
+// iterator ops struct definition
+// extends `ops` with the iterator operations
+template<typename Ref>
+struct iterator_ops {
+    using binary_func = void(*)(void* dst, void* src);
+    using copy_func = void(*)(void* dst, const void* src);
+    using unary_func = void(*)(void* dst);
+    using deref_func_type = Ref(*)(const void* it);
+    using equal_func_type = bool(*)(const void* lhs, const void* rhs);
+    using callback = void(*)(void* fn, Ref value);
+    using for_each_func_type = void(*)(const void* first, const void* last, void* fn, callback call);
+
+    copy_func copy_construct_func;
+    binary_func move_construct_func;
+    unary_func destruct_func;
+    unary_func increment_func;
+    // equals to `nullptr` for non-bidirectional iterators
+    unary_func decrement_func;
+    deref_func_type deref_func;
+    equal_func_type equal_func;
+    for_each_func_type for_each_func;
+};
+
+template<typename It>
+void copy_construct_func(void* dst, const void* src) {
+    new (dst) It(*static_cast<const It*>(src));
+}
+
+template<typename It>
+void increment_func(void* it) {
+    ++*static_cast<It*>(it);
+}
+
+template<typename It>
+void decrement_func(void* it) {
+    --*static_cast<It*>(it);
+}
+
+template<typename It>
+consteval void(*select_decrement_func())(void*) {
+    if constexpr (std::bidirectional_iterator<It>) {
+        return &decrement_func<It>;
+    } else {
+        return nullptr;
+    }
+}
+
+template<typename Ref, typename It>
+Ref deref_func(const void* it) {
+    return **static_cast<const It*>(it);
+}
+
+template<typename It>
+bool equal_func(const void* lhs, const void* rhs) {
+    return *static_cast<const It*>(lhs) == *static_cast<const It*>(rhs);
+}
+
+// the whole loop runs inside the typed function, the only indirect call
+// per element is the callback
+template<typename Ref, typename It>
+void for_each_func(const void* first, const void* last, void* fn, typename iterator_ops<Ref>::callback call) {
+    const It& end = *static_cast<const It*>(last);
+    for (It it = *static_cast<const It*>(first); it != end; ++it) {
+        call(fn, *it);
+    }
+}
+
+template<typename Ref, typename It>
+inline constexpr iterator_ops<Ref> iterator_ops_for{
+    .copy_construct_func = &copy_construct_func<It>,
+    .move_construct_func = &call_typed_func<It, move_constructer<It>>,
+    .destruct_func = &destruct_func<It>,
+    .increment_func = &increment_func<It>,
+    .decrement_func = select_decrement_func<It>(),
+    .deref_func = &deref_func<Ref, It>,
+    .equal_func = &equal_func<It>,
+    .for_each_func = &for_each_func<Ref, It>,
+};
+
+} // namespace _
+
+// type-erased iterator holding the concrete iterator inline
+// every operation is a single indirect call through the ops table
+template<typename Ref, typename Category = std::forward_iterator_tag, std::size_t Size = 4 * sizeof(void*)>
+class static_any_iterator {
+private:
+    static constexpr std::size_t buffer_size = Size;
+    static constexpr std::size_t align = alignof(std::max_align_t);
+    static constexpr bool is_bidirectional = std::is_base_of_v<std::bidirectional_iterator_tag, Category>;
+
+    using ops_ptr = const _::iterator_ops<Ref>*;
+
+    // equals to `nullptr` for a default-constructed iterator
+    ops_ptr ops_;
+    mutable std::aligned_storage_t<buffer_size, align> buf_;
+
+    template<typename It>
+    struct iterator_check {
+        static constexpr bool ok = sizeof(It) <= buffer_size
+            && alignof(It) <= align
+            && std::is_convertible_v<std::iter_reference_t<It>, Ref>
+            // a reference can't be bound to the prvalue of the iterator,
+            // it would dangle once `deref_func` returns
+            && (!std::is_reference_v<Ref> || std::is_reference_v<std::iter_reference_t<It>>)
+            && std::is_base_of_v<Category, typename std::iterator_traits<It>::iterator_category>;
+    };
+
+    template<typename R, typename C, std::size_t S>
+    friend class static_any_range;
+
+public:
+    using value_type = std::remove_cvref_t<Ref>;
+    using reference = Ref;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = Category;
+
+    // operators, ctors, dtor
+    static_any_iterator() noexcept : ops_{nullptr} {}
+
+    template<typename It>
+    static_any_iterator(It it)
+        requires(!std::is_same_v<It, static_any_iterator> && iterator_check<It>::ok)
+        : ops_{&_::iterator_ops_for<Ref, It>}
+    {
+        new (&buf_) It(std::move(it));
+    }
+
+    static_any_iterator(const static_any_iterator& rhs) : ops_{rhs.ops_} {
+        if (ops_) {
+            (ops_->copy_construct_func)(&buf_, &rhs.buf_);
+        }
+    }
+
+    static_any_iterator(static_any_iterator&& rhs) : ops_{rhs.ops_} {
+        if (ops_) {
+            (ops_->move_construct_func)(&buf_, &rhs.buf_);
+        }
+    }
+
+    static_any_iterator& operator=(const static_any_iterator& rhs) {
+        if (this != &rhs) {
+            reset();
+            if (rhs.ops_) {
+                (rhs.ops_->copy_construct_func)(&buf_, &rhs.buf_);
+                ops_ = rhs.ops_;
+            }
+        }
+        return *this;
+    }
+
+    static_any_iterator& operator=(static_any_iterator&& rhs) {
+        if (this != &rhs) {
+            reset();
+            if (rhs.ops_) {
+                (rhs.ops_->move_construct_func)(&buf_, &rhs.buf_);
+                ops_ = rhs.ops_;
+            }
+        }
+        return *this;
+    }
+
+    ~static_any_iterator() {
+        reset();
+    }
+
+    // destruct the underlying iterator
+    void reset() noexcept {
+        if (ops_) {
+            (ops_->destruct_func)(&buf_);
+            ops_ = nullptr;
+        }
+    }
+
+    // iterator operations
+    Ref operator*() const {
+        return (ops_->deref_func)(&buf_);
+    }
+
+    static_any_iterator& operator++() {
+        (ops_->increment_func)(&buf_);
+        return *this;
+    }
+
+    static_any_iterator operator++(int) {
+        static_any_iterator tmp = *this;
+        ++*this;
+        return tmp;
+    }
+
+    static_any_iterator& operator--() requires(is_bidirectional) {
+        (ops_->decrement_func)(&buf_);
+        return *this;
+    }
+
+    static_any_iterator operator--(int) requires(is_bidirectional) {
+        static_any_iterator tmp = *this;
+        --*this;
+        return tmp;
+    }
+
+    // iterators holding different types are never equal
+    bool operator==(const static_any_iterator& rhs) const {
+        if (ops_ != rhs.ops_) {
+            return false;
+        }
+        return !ops_ || (ops_->equal_func)(&buf_, &rhs.buf_);
+    }
+};
+
+// type-erased range of two static_any_iterator's
+// the underlying range must outlive it
+template<typename Ref, typename Category = std::forward_iterator_tag, std::size_t Size = 4 * sizeof(void*)>
+class static_any_range {
+public:
+    using iterator = static_any_iterator<Ref, Category, Size>;
+
+private:
+    iterator begin_;
+    iterator end_;
+
+public:
+    static_any_range() = default;
+
+    // both iterators must hold the same type
+    static_any_range(iterator begin, iterator end)
+        : begin_{std::move(begin)}
+        , end_{std::move(end)}
+    {
+        if (begin_.ops_ != end_.ops_) {
+            throw std::invalid_argument("sp::static_any_range: the iterators hold different types");
+        }
+    }
+
+    template<typename Range>
+    static_any_range(Range&& range)
+        requires(!std::is_same_v<std::remove_cvref_t<Range>, static_any_range>
+            && std::ranges::common_range<Range>
+            && std::is_constructible_v<iterator, std::ranges::iterator_t<Range>>)
+        : begin_{std::ranges::begin(range)}
+        , end_{std::ranges::end(range)}
+    {}
+
+    iterator begin() const { return begin_; }
+    iterator end() const { return end_; }
+
+    bool empty() const { return begin_ == end_; }
+
+    // internal iteration, costs one indirect call per element
+    // the range-for loop costs three: comparison, dereference and increment
+    template<typename F>
+    void for_each(F&& fn) const {
+        if (!begin_.ops_) {
+            return;
+        }
+        using Fn = std::remove_reference_t<F>;
+        auto call = [](void* f, Ref value) {
+            (*static_cast<Fn*>(f))(std::forward<Ref>(value));
+        };
+        (begin_.ops_->for_each_func)(&begin_.buf_, &end_.buf_, const_cast<void*>(static_cast<const void*>(std::addressof(fn))), call);
+    }
+};
+
+} // namespace sp
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace sp {
+
+// message hook for error details
+// specialize it for types without a `message()` method
+template<typename T>
+struct error_traits {
+    static void render(const T& value, std::string& out) {
+        out.append(std::string_view{value.message()});
+    }
+};
+
+namespace _ {
+
+// error ops struct definition
+// extends `ops` with the hook of `error_traits`
+struct error_ops {
+    using render_func_type = void(*)(const void* value, std::string& out);
+
+    ops_ptr ops;
+    render_func_type render_func;
+};
+
+template<typename T>
+void render_func(const void* value, std::string& out) {
+    error_traits<T>::render(*static_cast<const T*>(value), out);
+}
+
+template<typename T>
+inline constexpr error_ops error_ops_for{
+    .ops = &ops_for<T>,
+    .render_func = &render_func<T>,
+};
+
+} // namespace _
+
+// error payload holding an error detail of any type inline
+// the details need no common base, they are told apart by the ops table
+// and must be nothrow movable, so that moving an error never throws
+// nor allocates, details of trivially relocatable types are moved bytewise
+template<std::size_t Size = 32>
+class static_error {
+private:
+    static constexpr std::size_t align = alignof(std::max_align_t);
+
+    template<std::size_t> friend class static_error;
+
+    // equals to `nullptr` when there is no error
+    const _::error_ops* ops_;
+    std::aligned_storage_t<Size, align> buf_;
+
+    template<typename T>
+    struct detail_check {
+        static constexpr bool ok = sizeof(T) <= Size && std::is_nothrow_move_constructible_v<T>
+            && std::is_nothrow_move_assignable_v<T>;
+    };
+
+    template<std::size_t RhsSize>
+    void move_from(static_error<RhsSize>& rhs) noexcept {
+        _::ops_ptr dst_ops = ops_ ? ops_->ops : nullptr;
+        _::ops_ptr src_ops = rhs.ops_ ? rhs.ops_->ops : nullptr;
+        _::move_construct<std::min(Size, RhsSize)>(&buf_, dst_ops, &rhs.buf_, src_ops);
+        ops_ = std::exchange(rhs.ops_, nullptr);
+    }
+
+public:
+    // operators, ctors, dtor
+    static_error() noexcept : ops_{nullptr} {}
+
+    // the detail of a smaller error fits into a larger one
+    template<std::size_t RhsSize>
+    static_error(static_error<RhsSize>&& rhs) noexcept
+        requires(RhsSize <= Size)
+        : ops_{nullptr}
+    {
+        move_from(rhs);
+    }
+
+    template<std::size_t RhsSize>
+    static_error& operator=(static_error<RhsSize>&& rhs) noexcept
+        requires(RhsSize <= Size)
+    {
+        if (static_cast<void*>(&rhs) != this) {
+            move_from(rhs);
+        }
+        return *this;
+    }
+
+    static_error(const static_error&) = delete;
+    static_error& operator=(const static_error&) = delete;
+
+    ~static_error() {
+        reset();
+    }
+
+    // in-place (re)initialization
+    template<typename T, typename ...Args>
+    T& emplace(Args&&... args)
+        noexcept(std::is_nothrow_constructible_v<T, Args...>)
+        requires(detail_check<T>::ok)
+    {
+        reset();
+        T* detail = new (&buf_) T(std::forward<Args>(args)...);
+        ops_ = &_::error_ops_for<T>;
+        return *detail;
+    }
+
+    void reset() noexcept {
+        if (ops_) {
+            _::destruct(&buf_, ops_->ops);
+            ops_ = nullptr;
+        }
+    }
+
+    // whether the detail is exactly of type `T`
+    template<typename T>
+    bool holds() const noexcept {
+        return ops_ == &_::error_ops_for<T>;
+    }
+
+    // the detail if it is exactly of type `T`, otherwise `nullptr`
+    template<typename T>
+    T* get_if() noexcept {
+        return holds<T>() ? reinterpret_cast<T*>(&buf_) : nullptr;
+    }
+    template<typename T>
+    const T* get_if() const noexcept {
+        return holds<T>() ? reinterpret_cast<const T*>(&buf_) : nullptr;
+    }
+
+    // append the message of the detail to `out`
+    void render(std::string& out) const {
+        if (ops_) {
+            (*ops_->render_func)(&buf_, out);
+        }
+    }
+
+    std::string message() const {
+        std::string out;
+        render(out);
+        return out;
+    }
+
+    operator bool() const noexcept { return ops_; }
+};
+
+template<typename T, std::size_t Size = 32, typename ...Args>
+static_error<Size> make_error(Args&&... args) {
+    static_error<Size> error;
+    error.template emplace<T>(std::forward<Args>(args)...);
+    return error;
+}
+
+} // namespace sp
@@ -0,0 +1,18 @@
+// C++20 module interface of the static_ptr library
+// `static_ptr.h` stays available for compatibility, the module exports the
+// same entities; macros can't be exported, so the traits are specialized
+// directly instead of STATIC_PTR_BUFFER_SIZE and similar macros
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+export module static_ptr;
+
+#define STATIC_PTR_EXPORT export
+#include "static_ptr.h"
@@ -1,11 +1,48 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <memory>
+#include <new>
 #include <type_traits>
+#include <utility>
+
+// the module interface defines it as `export`
+#ifndef STATIC_PTR_EXPORT
+#define STATIC_PTR_EXPORT
+#endif
+
+// sampling of the dereferences, see `dispatch_profile.h`
+// the profiled dereference is always inlined, so it's recorded at its call site
+#ifdef STATIC_PTR_PROFILE
+#include "dispatch_profile.h"
+#define STATIC_PTR_PROFILED [[gnu::always_inline]]
+#else
+#define STATIC_PTR_PROFILED
+#endif
+
+// recording of the operations, see `op_trace.h`
+#ifdef STATIC_PTR_TRACE
+#include "op_trace.h"
+#endif
 
 namespace sp {
 
+// trivial relocation trait
+// a type is trivially relocatable if moving an object to a new address and
+// destroying the source is equivalent to copying its bytes
+STATIC_PTR_EXPORT template<typename T>
+struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+STATIC_PTR_EXPORT template<typename T>
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+// mark of a whole hierarchy, set by STATIC_PTR_TRIVIALLY_RELOCATABLE
+// static_ptr needs it, since its base alone says nothing about the stored type
+STATIC_PTR_EXPORT template<typename T>
+struct is_trivially_relocatable_hierarchy : std::false_type {};
+
 namespace _ {
 
 // functors
@@ -45,6 +82,16 @@ struct move_assigner {
     }
 };
 
+template<typename T>
+struct copy_constructer {
+    static void call(T* lhs, T* rhs)
+        noexcept (std::is_nothrow_copy_constructible_v<T>)
+        requires (std::is_copy_constructible_v<T>)
+    {
+        new (lhs) T(*rhs);
+    }
+};
+
 // ops struct definition
 struct ops {
     using binary_func = void(*)(void* dst, void* src);
@@ -53,6 +100,12 @@ struct ops {
     binary_func move_construct_func;
     binary_func move_assign_func;
     unary_func destruct_func;
+    // equals to `nullptr` if the type is not copy constructible
+    binary_func copy_construct_func;
+
+    // capabilities of the type, the hot paths check them to skip the indirect calls
+    bool trivially_destructible;
+    bool trivially_relocatable;
 };
 
 template<typename T, typename Functor>
@@ -66,58 +119,109 @@ void destruct_func(void* dst) {
 }
 
 template<typename T>
-static constexpr ops ops_for{
+consteval ops::binary_func copy_construct_func() {
+    if constexpr (std::is_copy_constructible_v<T>) {
+        return &call_typed_func<T, copy_constructer<T>>;
+    } else {
+        return nullptr;
+    }
+}
+
+template<typename T>
+inline constexpr ops ops_for{
     .move_construct_func = &call_typed_func<T, move_constructer<T>>,
     .move_assign_func = &call_typed_func<T, move_assigner<T>>,
     .destruct_func = &destruct_func<T>,
+    .copy_construct_func = copy_construct_func<T>(),
+    .trivially_destructible = std::is_trivially_destructible_v<T>,
+    .trivially_relocatable = is_trivially_relocatable_v<T>,
 };
 using ops_ptr = const ops*;
 
+// destructing objects using ops
+inline void destruct(void* buf, ops_ptr ops) {
+    if (!ops->trivially_destructible) {
+        (*ops->destruct_func)(buf);
+    }
+}
+
 // moving objects using ops
-static void move_construct(void* dst_buf, ops_ptr& dst_ops,
-                           void* src_buf, ops_ptr& src_ops) {
+// `Size` bytes of the source buffer fit into the destination buffer
+template<std::size_t Size>
+void move_construct(void* dst_buf, ops_ptr& dst_ops,
+                    void* src_buf, ops_ptr& src_ops) {
     if (!src_ops && !dst_ops) {
         // both object are nullptr_t, do nothing
         return;
     } else if (src_ops == dst_ops) {
         // objects have the same type, make move
-        (*src_ops->move_assign_func)(dst_buf, src_buf);
-        (*src_ops->destruct_func)(src_buf);
+        if (src_ops->trivially_relocatable) {
+            destruct(dst_buf, dst_ops);
+            std::memcpy(dst_buf, src_buf, Size);
+        } else {
+            (*src_ops->move_assign_func)(dst_buf, src_buf);
+            destruct(src_buf, src_ops);
+        }
         src_ops = nullptr;
     } else {
         // objects have different type
         // delete the old object
         if (dst_ops) {
-            (*dst_ops->destruct_func)(dst_buf);
+            destruct(dst_buf, dst_ops);
             dst_ops = nullptr;
         }
         // construct the new object
         if (src_ops) {
-            (*src_ops->move_construct_func)(dst_buf, src_buf);
-            (*src_ops->destruct_func)(src_buf);
+            if (src_ops->trivially_relocatable) {
+                std::memcpy(dst_buf, src_buf, Size);
+            } else {
+                (*src_ops->move_construct_func)(dst_buf, src_buf);
+                destruct(src_buf, src_ops);
+            }
         }
         dst_ops = src_ops;
         src_ops = nullptr;
     }
 }
 
+// copying objects using ops
+// the source object must be copy constructible
+inline void copy_construct(void* dst_buf, ops_ptr& dst_ops,
+                           void* src_buf, ops_ptr src_ops) {
+    // delete the old object
+    if (dst_ops) {
+        destruct(dst_buf, dst_ops);
+        dst_ops = nullptr;
+    }
+    // construct the copy
+    if (src_ops) {
+        (*src_ops->copy_construct_func)(dst_buf, src_buf);
+        dst_ops = src_ops;
+    }
+}
+
+// access to static_ptr's internals for containers
+struct access;
+
 } // namespace _
 
 // static_ptr traits struct
-template<typename T>
+STATIC_PTR_EXPORT template<typename T>
 struct static_ptr_traits {
     static constexpr std::size_t buffer_size = std::max(static_cast<std::size_t>(16), sizeof(T));
 };
 
-template<typename Base>
+// the buffer size can be given explicitly, `0` means it is taken from traits
+STATIC_PTR_EXPORT template<typename Base, std::size_t BufferSize = 0>
 requires(!std::is_void_v<Base>)
 class static_ptr {
 private:
-    static constexpr std::size_t buffer_size = static_ptr_traits<Base>::buffer_size;
+    static constexpr std::size_t buffer_size = BufferSize ? BufferSize : static_ptr_traits<Base>::buffer_size;
     static constexpr std::size_t align = alignof(std::max_align_t);
 
     // support static_ptr's conversions of different types
-    template <typename T> friend class static_ptr;
+    template <typename T, std::size_t> requires(!std::is_void_v<T>) friend class static_ptr;
+    friend struct _::access;
 
     // Struct for calling object's operators
     // equals to `nullptr` when `buf_` contains no object
@@ -134,6 +238,27 @@ private:
         static constexpr bool ok = sizeof(Derived) <= buffer_size && std::is_base_of_v<Base, Derived>;
     };
 
+    // the source may hold any type which fits into its own buffer, so its
+    // buffer must fit into this one
+    template<typename Derived, std::size_t DerivedSize>
+    struct converted_class_check {
+        static constexpr bool ok = derived_class_check<Derived>::ok
+            && static_ptr<Derived, DerivedSize>::buffer_size <= buffer_size;
+    };
+
+#ifdef STATIC_PTR_TRACE
+    void trace_dispatch() const noexcept {
+        if (ops_) {
+            _::trace(trace_op::dispatch, this);
+        }
+    }
+#endif
+
+    // number of bytes copied when relocating from `static_ptr<Derived, DerivedSize>`
+    // `converted_class_check` makes it fit into this buffer
+    template<typename Derived, std::size_t DerivedSize>
+    static constexpr std::size_t move_size = static_ptr<Derived, DerivedSize>::buffer_size;
+
 public:
     // operators, ctors, dtor
     static_ptr() noexcept : ops_{nullptr} {}
@@ -144,19 +269,29 @@ public:
         return *this;
     }
 
-    template<typename Derived = Base>
-    static_ptr(static_ptr<Derived>&& rhs)
-        requires(derived_class_check<Derived>::ok)
+    template<typename Derived = Base, std::size_t DerivedSize = 0>
+    static_ptr(static_ptr<Derived, DerivedSize>&& rhs)
+        requires(converted_class_check<Derived, DerivedSize>::ok)
         : ops_{nullptr}
     {
-        _::move_construct(&buf_, ops_, &rhs.buf_, rhs.ops_);
+#ifdef STATIC_PTR_TRACE
+        if (rhs.ops_) {
+            _::trace(trace_op::move, this, std::addressof(rhs));
+        }
+#endif
+        _::move_construct<move_size<Derived, DerivedSize>>(&buf_, ops_, &rhs.buf_, rhs.ops_);
     }
 
-    template<typename Derived = Base>
-    static_ptr& operator=(static_ptr<Derived>&& rhs)
-        requires(derived_class_check<Derived>::ok)
+    template<typename Derived = Base, std::size_t DerivedSize = 0>
+    static_ptr& operator=(static_ptr<Derived, DerivedSize>&& rhs)
+        requires(converted_class_check<Derived, DerivedSize>::ok)
     {
-        _::move_construct(&buf_, ops_, &rhs.buf_, rhs.ops_);
+#ifdef STATIC_PTR_TRACE
+        if (rhs.ops_ || ops_) {
+            _::trace(trace_op::move, this, std::addressof(rhs));
+        }
+#endif
+        _::move_construct<move_size<Derived, DerivedSize>>(&buf_, ops_, &rhs.buf_, rhs.ops_);
         return *this;
     }
 
@@ -176,13 +311,19 @@ public:
         reset();
         Derived* derived = new (&buf_) Derived(std::forward<Args>(args)...);
         ops_ = &_::ops_for<Derived>;
+#ifdef STATIC_PTR_TRACE
+        _::trace_emplace<Derived>(this);
+#endif
         return *derived;
     }
 
     // destruct the underlying object
     void reset() noexcept(std::is_nothrow_destructible_v<Base>) {
         if (ops_) {
-            (ops_->destruct_func)(&buf_);
+#ifdef STATIC_PTR_TRACE
+            _::trace(trace_op::reset, this);
+#endif
+            _::destruct(&buf_, ops_);
             ops_ = nullptr;
         }
     }
@@ -195,22 +336,77 @@ public:
         return ops_ ? reinterpret_cast<const Base*>(&buf_) : nullptr;
     }
 
-    Base& operator*() noexcept { return *get(); }
-    const Base& operator*() const noexcept { return *get(); }
+    Base& operator*() noexcept {
+#ifdef STATIC_PTR_TRACE
+        trace_dispatch();
+#endif
+        return *get();
+    }
+    const Base& operator*() const noexcept {
+#ifdef STATIC_PTR_TRACE
+        trace_dispatch();
+#endif
+        return *get();
+    }
 
     Base* operator&() noexcept { return get(); }
     const Base* operator&() const noexcept { return get(); }
 
-    Base* operator->() noexcept { return get(); }
-    const Base* operator->() const noexcept { return get(); }
+    STATIC_PTR_PROFILED Base* operator->() noexcept {
+#ifdef STATIC_PTR_PROFILE
+        _::sample_dispatch(get());
+#endif
+#ifdef STATIC_PTR_TRACE
+        trace_dispatch();
+#endif
+        return get();
+    }
+    STATIC_PTR_PROFILED const Base* operator->() const noexcept {
+#ifdef STATIC_PTR_PROFILE
+        _::sample_dispatch(get());
+#endif
+#ifdef STATIC_PTR_TRACE
+        trace_dispatch();
+#endif
+        return get();
+    }
 
     operator bool() const noexcept { return ops_; }
 };
 
-template<typename T, class ...Args>
-static static_ptr<T> make_static(Args&&... args) {
+namespace _ {
+
+struct access {
+    template<typename Base, std::size_t BufferSize>
+    static ops_ptr& ops(static_ptr<Base, BufferSize>& ptr) noexcept { return ptr.ops_; }
+
+    template<typename Base, std::size_t BufferSize>
+    static ops_ptr ops(const static_ptr<Base, BufferSize>& ptr) noexcept { return ptr.ops_; }
+
+    template<typename Base, std::size_t BufferSize>
+    static void* buf(const static_ptr<Base, BufferSize>& ptr) noexcept { return &ptr.buf_; }
+};
+
+// replace the object held by `dst` by a copy of the object held by `src`
+// the object must be copy constructible
+template<typename Base, std::size_t BufferSize>
+void clone(static_ptr<Base, BufferSize>& dst, const static_ptr<Base, BufferSize>& src) {
+    copy_construct(access::buf(dst), access::ops(dst), access::buf(src), access::ops(src));
+}
+
+} // namespace _
+
+// static_ptr is trivially relocatable if the hierarchy it holds is marked,
+// or if it can hold only `Base` itself
+template<typename Base, std::size_t BufferSize>
+struct is_trivially_relocatable<static_ptr<Base, BufferSize>>
+    : std::bool_constant<is_trivially_relocatable_hierarchy<Base>::value
+        || ((!std::is_class_v<Base> || std::is_final_v<Base>) && is_trivially_relocatable_v<Base>)> {};
+
+STATIC_PTR_EXPORT template<typename T, class ...Args>
+static_ptr<T> make_static(Args&&... args) {
     static_ptr<T> ptr;
-    ptr.emplace(std::forward<Args>(args)...);
+    ptr.template emplace<T>(std::forward<Args>(args)...);
     return ptr;
 }
 
@@ -230,3 +426,13 @@ namespace sp {                                             \
         static constexpr std::size_t buffer_size = size;   \
     };                                                     \
 }
+
+#define STATIC_PTR_TRIVIALLY_RELOCATABLE(Tp)               \
+namespace sp {                                             \
+    template<typename T> requires std::is_base_of_v<Tp, T> \
+    struct is_trivially_relocatable<T>                     \
+        : std::true_type {};                               \
+    template<typename T> requires std::is_base_of_v<Tp, T> \
+    struct is_trivially_relocatable_hierarchy<T>           \
+        : std::true_type {};                               \
+}
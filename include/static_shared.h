@@ -0,0 +1,329 @@
+#pragma once
+
+#include "static_ptr.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sp {
+
+namespace _ {
+
+// reference counters
+template<bool Atomic>
+struct refcount;
+
+template<>
+struct refcount<false> {
+    std::size_t value;
+
+    std::size_t load() const noexcept { return value; }
+    void increment() noexcept { ++value; }
+    // returns true if the counter dropped to zero
+    bool decrement() noexcept { return --value == 0; }
+    // returns false if the counter is zero
+    bool increment_if_nonzero() noexcept {
+        if (value == 0) {
+            return false;
+        }
+        ++value;
+        return true;
+    }
+};
+
+template<>
+struct refcount<true> {
+    std::atomic<std::size_t> value;
+
+    std::size_t load() const noexcept { return value.load(std::memory_order_acquire); }
+    void increment() noexcept { value.fetch_add(1, std::memory_order_relaxed); }
+    bool decrement() noexcept { return value.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+    bool increment_if_nonzero() noexcept {
+        std::size_t count = value.load(std::memory_order_relaxed);
+        while (count != 0) {
+            if (value.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// mutex which does nothing, for single-threaded slabs
+struct null_mutex {
+    void lock() noexcept {}
+    void unlock() noexcept {}
+};
+
+} // namespace _
+
+template<typename Base, bool Atomic>
+class shared_slab;
+
+template<typename Base, bool Atomic>
+class static_shared;
+
+template<typename Base, bool Atomic>
+class static_weak;
+
+namespace _ {
+
+// slab slot: the object's storage together with its control block
+template<typename Base, bool Atomic>
+struct shared_slot {
+    static constexpr std::size_t buffer_size = static_ptr_traits<Base>::buffer_size;
+    static constexpr std::size_t align = alignof(std::max_align_t);
+
+    // equals to `nullptr` when the object is destroyed
+    ops_ptr ops;
+    // number of static_shared's
+    refcount<Atomic> strong;
+    // number of static_weak's, plus one while `strong` is nonzero
+    refcount<Atomic> weak;
+    shared_slab<Base, Atomic>* slab;
+    // next slot in the slab's free list
+    shared_slot* next_free;
+    std::aligned_storage_t<buffer_size, align> buf;
+
+    Base* get() noexcept {
+        return reinterpret_cast<Base*>(&buf);
+    }
+
+    void release_weak() noexcept {
+        if (weak.decrement()) {
+            slab->deallocate(this);
+        }
+    }
+
+    void release_strong() noexcept(std::is_nothrow_destructible_v<Base>) {
+        if (strong.decrement()) {
+            destruct(&buf, ops);
+            ops = nullptr;
+            release_weak();
+        }
+    }
+};
+
+} // namespace _
+
+// owner of the slots for static_shared objects
+// slots are allocated in chunks of `chunk_size`, so creating an object
+// usually doesn't allocate; the slab must outlive all its handles
+template<typename Base, bool Atomic = true>
+class shared_slab {
+private:
+    using slot_type = _::shared_slot<Base, Atomic>;
+    using mutex_type = std::conditional_t<Atomic, std::mutex, _::null_mutex>;
+
+    friend struct _::shared_slot<Base, Atomic>;
+
+    static constexpr std::size_t chunk_size = 64;
+
+    template<typename Derived>
+    struct derived_class_check {
+        static constexpr bool ok = sizeof(Derived) <= slot_type::buffer_size && std::is_base_of_v<Base, Derived>;
+    };
+
+    std::vector<std::unique_ptr<slot_type[]>> chunks_;
+    slot_type* free_;
+    std::size_t size_;
+    mutex_type mutex_;
+
+    slot_type* allocate() {
+        std::lock_guard guard{mutex_};
+        if (!free_) {
+            auto& chunk = chunks_.emplace_back(new slot_type[chunk_size]);
+            for (std::size_t i = 0; i < chunk_size; ++i) {
+                chunk[i].next_free = i + 1 < chunk_size ? &chunk[i + 1] : nullptr;
+            }
+            free_ = &chunk[0];
+        }
+        slot_type* slot = free_;
+        free_ = slot->next_free;
+        ++size_;
+        return slot;
+    }
+
+    void deallocate(slot_type* slot) noexcept {
+        std::lock_guard guard{mutex_};
+        slot->next_free = free_;
+        free_ = slot;
+        --size_;
+    }
+
+public:
+    shared_slab() noexcept : free_{nullptr}, size_{0} {}
+
+    shared_slab(const shared_slab&) = delete;
+    shared_slab& operator=(const shared_slab&) = delete;
+
+    // create a shared object in a free slot
+    template<typename Derived = Base, typename ...Args>
+    static_shared<Base, Atomic> make(Args&&... args)
+        requires(derived_class_check<Derived>::ok)
+    {
+        slot_type* slot = allocate();
+        try {
+            new (&slot->buf) Derived(std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate(slot);
+            throw;
+        }
+        slot->ops = &_::ops_for<Derived>;
+        slot->slab = this;
+        new (&slot->strong) _::refcount<Atomic>{1};
+        new (&slot->weak) _::refcount<Atomic>{1};
+        return static_shared<Base, Atomic>{slot};
+    }
+
+    // number of slots in use (by objects or by weak handles)
+    std::size_t size() const noexcept { return size_; }
+    // number of allocated slots
+    std::size_t capacity() const noexcept { return chunks_.size() * chunk_size; }
+};
+
+// shared handle to an object in a shared_slab
+// copying only bumps the counter of the slot
+template<typename Base, bool Atomic = true>
+class static_shared {
+private:
+    using slot_type = _::shared_slot<Base, Atomic>;
+
+    friend class shared_slab<Base, Atomic>;
+    friend class static_weak<Base, Atomic>;
+
+    slot_type* slot_;
+
+    explicit static_shared(slot_type* slot) noexcept : slot_{slot} {}
+
+public:
+    // operators, ctors, dtor
+    static_shared() noexcept : slot_{nullptr} {}
+    static_shared(std::nullptr_t) noexcept : slot_{nullptr} {}
+
+    static_shared(const static_shared& rhs) noexcept : slot_{rhs.slot_} {
+        if (slot_) {
+            slot_->strong.increment();
+        }
+    }
+
+    static_shared(static_shared&& rhs) noexcept : slot_{std::exchange(rhs.slot_, nullptr)} {}
+
+    static_shared& operator=(const static_shared& rhs) {
+        static_shared{rhs}.swap(*this);
+        return *this;
+    }
+
+    static_shared& operator=(static_shared&& rhs) {
+        static_shared{std::move(rhs)}.swap(*this);
+        return *this;
+    }
+
+    static_shared& operator=(std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    ~static_shared() {
+        reset();
+    }
+
+    void swap(static_shared& rhs) noexcept {
+        std::swap(slot_, rhs.slot_);
+    }
+
+    // release the object, it is destructed if this was the last handle
+    void reset() noexcept(std::is_nothrow_destructible_v<Base>) {
+        if (slot_) {
+            std::exchange(slot_, nullptr)->release_strong();
+        }
+    }
+
+    std::size_t use_count() const noexcept {
+        return slot_ ? slot_->strong.load() : 0;
+    }
+
+    // accessors
+    Base* get() const noexcept {
+        return slot_ ? slot_->get() : nullptr;
+    }
+
+    Base& operator*() const noexcept { return *get(); }
+    Base* operator->() const noexcept { return get(); }
+
+    operator bool() const noexcept { return slot_; }
+
+    bool operator==(const static_shared& rhs) const noexcept { return slot_ == rhs.slot_; }
+};
+
+// weak handle to an object in a shared_slab
+// keeps the slot (but not the object) alive
+template<typename Base, bool Atomic = true>
+class static_weak {
+private:
+    using slot_type = _::shared_slot<Base, Atomic>;
+
+    slot_type* slot_;
+
+public:
+    // operators, ctors, dtor
+    static_weak() noexcept : slot_{nullptr} {}
+
+    static_weak(const static_shared<Base, Atomic>& shared) noexcept : slot_{shared.slot_} {
+        if (slot_) {
+            slot_->weak.increment();
+        }
+    }
+
+    static_weak(const static_weak& rhs) noexcept : slot_{rhs.slot_} {
+        if (slot_) {
+            slot_->weak.increment();
+        }
+    }
+
+    static_weak(static_weak&& rhs) noexcept : slot_{std::exchange(rhs.slot_, nullptr)} {}
+
+    static_weak& operator=(static_weak rhs) noexcept {
+        std::swap(slot_, rhs.slot_);
+        return *this;
+    }
+
+    ~static_weak() {
+        reset();
+    }
+
+    void reset() noexcept {
+        if (slot_) {
+            std::exchange(slot_, nullptr)->release_weak();
+        }
+    }
+
+    bool expired() const noexcept {
+        return !slot_ || slot_->strong.load() == 0;
+    }
+
+    // get a shared handle, it is empty if the object is already destructed
+    static_shared<Base, Atomic> lock() const noexcept {
+        if (slot_ && slot_->strong.increment_if_nonzero()) {
+            return static_shared<Base, Atomic>{slot_};
+        }
+        return nullptr;
+    }
+};
+
+// single-threaded flavour
+template<typename Base>
+using local_shared_slab = shared_slab<Base, false>;
+
+template<typename Base>
+using local_shared = static_shared<Base, false>;
+
+template<typename Base>
+using local_weak = static_weak<Base, false>;
+
+} // namespace sp
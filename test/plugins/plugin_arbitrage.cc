@@ -0,0 +1,14 @@
+#include "strategy.h"
+
+namespace {
+
+class TArbitrage : public IStrategy {
+public:
+    int Signal(int price) const override { return price % 2 ? 1 : 0; }
+};
+
+} // namespace
+
+STATIC_PTR_PLUGIN(IStrategy, registrar) {
+    registrar.add<TArbitrage>(ArbitrageId, "arbitrage");
+}
@@ -0,0 +1,32 @@
+#include "strategy.h"
+
+#include <vector>
+
+namespace {
+
+class TMomentum : public IStrategy {
+public:
+    int Signal(int price) const override { return price > Threshold_ ? 1 : -1; }
+
+private:
+    int Threshold_ = 100;
+};
+
+// not trivially relocatable, moves and copies go through the plugin's code
+class TTrend : public IStrategy {
+public:
+    TTrend() : History_{1, 2, 3} {}
+    int Signal(int price) const override { return price * static_cast<int>(History_.size()); }
+
+private:
+    std::vector<int> History_;
+};
+
+} // namespace
+
+STATIC_PTR_TRIVIALLY_RELOCATABLE(TMomentum)
+
+STATIC_PTR_PLUGIN(IStrategy, registrar) {
+    registrar.add<TMomentum>(MomentumId, "momentum");
+    registrar.add<TTrend>(TrendId, "trend");
+}
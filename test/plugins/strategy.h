@@ -0,0 +1,16 @@
+#pragma once
+
+#include "plugin_registry.h"
+
+#include <cstdint>
+
+// interface shared by the test and its plugins
+class IStrategy {
+public:
+    virtual ~IStrategy() = default;
+    virtual int Signal(int price) const = 0;
+};
+
+constexpr std::uint64_t MomentumId = 0x1001;
+constexpr std::uint64_t TrendId = 0x1002;
+constexpr std::uint64_t ArbitrageId = 0x2001;
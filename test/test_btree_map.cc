@@ -0,0 +1,198 @@
+#include "btree_map.h"
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+class ILevel {
+public:
+    virtual ~ILevel() = default;
+    virtual int Volume() const = 0;
+};
+
+class TLevel : public ILevel {
+public:
+    TLevel(int volume) : Volume_{volume} {}
+    int Volume() const override { return Volume_; }
+
+private:
+    int Volume_;
+};
+
+// not trivially relocatable, counts the live objects
+class TTrackedLevel : public ILevel {
+public:
+    TTrackedLevel(int& alive, int volume) : Alive_{&alive}, Volume_{volume} {
+        if (volume < 0) {
+            throw std::invalid_argument("negative volume");
+        }
+        ++*Alive_;
+    }
+    TTrackedLevel(TTrackedLevel&& rhs) : Alive_{rhs.Alive_}, Volume_{rhs.Volume_} {
+        ++*Alive_;
+    }
+    TTrackedLevel& operator=(TTrackedLevel&& rhs) {
+        Volume_ = rhs.Volume_;
+        return *this;
+    }
+    ~TTrackedLevel() {
+        --*Alive_;
+    }
+    int Volume() const override { return Volume_; }
+
+private:
+    int* Alive_;
+    int Volume_;
+    char Padding_[8] = {};
+};
+
+template<typename Map>
+std::vector<std::pair<int, int>> Entries(Map& map) {
+    std::vector<std::pair<int, int>> entries;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        entries.emplace_back(it.key(), it->Volume());
+    }
+    return entries;
+}
+
+TEST(BtreeMap, Basic) {
+    sp::btree_map<int, ILevel, std::less<int>, 32, 4> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.begin(), map.end());
+    EXPECT_EQ(map.get(1), nullptr);
+    EXPECT_FALSE(map.erase(1));
+
+    for (int i = 0; i < 20; ++i) {
+        map.emplace<TLevel>((i * 7) % 20, i);
+    }
+    EXPECT_EQ(map.size(), 20);
+    ASSERT_NE(map.get(14), nullptr);
+    EXPECT_EQ(map.get(14)->Volume(), 2);
+    EXPECT_TRUE(map.contains(19));
+    EXPECT_FALSE(map.contains(20));
+
+    // replacing the value
+    map.emplace<TLevel>(14, 100);
+    EXPECT_EQ(map.size(), 20);
+    EXPECT_EQ(map.get(14)->Volume(), 100);
+
+    std::vector<int> keys;
+    map.for_each([&](int key, ILevel&) { keys.push_back(key); });
+    EXPECT_EQ(keys.size(), 20);
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+
+    EXPECT_EQ(map.lower_bound(5).key(), 5);
+    EXPECT_EQ(map.upper_bound(5).key(), 6);
+    EXPECT_EQ(map.lower_bound(-5).key(), 0);
+    EXPECT_EQ(map.upper_bound(19), map.end());
+
+    for (int i = 0; i < 20; i += 2) {
+        EXPECT_TRUE(map.erase(i));
+    }
+    EXPECT_FALSE(map.erase(0));
+    EXPECT_EQ(map.size(), 10);
+    EXPECT_EQ(map.lower_bound(4).key(), 5);
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.begin(), map.end());
+}
+
+TEST(BtreeMap, Descending) {
+    // bids are ordered from the highest price
+    sp::btree_map<double, ILevel, std::greater<double>> bids;
+    for (int i = 0; i < 100; ++i) {
+        bids.emplace<TLevel>(100.0 + i * 0.5, i);
+    }
+    EXPECT_EQ(bids.begin().key(), 149.5);
+    EXPECT_EQ(bids.begin()->Volume(), 99);
+    EXPECT_EQ(bids.lower_bound(120.2).key(), 120.0);
+}
+
+TEST(BtreeMap, StringKeys) {
+    sp::btree_map<std::string, ILevel, std::less<std::string>, 0, 4> map;
+    for (int i = 0; i < 100; ++i) {
+        map.emplace<TLevel>("key" + std::to_string(i), i);
+    }
+    EXPECT_EQ(map.begin().key(), "key0");
+    EXPECT_EQ(map.get("key42")->Volume(), 42);
+    EXPECT_EQ(map.lower_bound("key5").key(), "key5");
+    EXPECT_EQ(map.upper_bound("key5").key(), "key50");
+}
+
+TEST(BtreeMap, ThrowingConstructor) {
+    int alive = 0;
+    {
+        sp::btree_map<int, ILevel, std::less<int>, 32, 4> map;
+        for (int i = 0; i < 10; ++i) {
+            map.emplace<TTrackedLevel>(i, alive, i);
+        }
+        EXPECT_THROW(map.emplace<TTrackedLevel>(20, alive, -1), std::invalid_argument);
+        EXPECT_THROW(map.emplace<TTrackedLevel>(5, alive, -1), std::invalid_argument);
+        EXPECT_EQ(map.size(), 10);
+        EXPECT_EQ(map.get(5)->Volume(), 5);
+        EXPECT_EQ(alive, 10);
+    }
+    EXPECT_EQ(alive, 0);
+}
+
+// compare with std::map on random operations, small nodes make a deep tree
+TEST(BtreeMap, Random) {
+    int alive = 0;
+    {
+        sp::btree_map<int, ILevel, std::less<int>, 32, 4> map;
+        std::map<int, int> expected;
+        std::mt19937 rng{42};
+        for (int i = 0; i < 50000; ++i) {
+            const int key = static_cast<int>(rng() % 2000);
+            switch (rng() % 4) {
+            case 0:
+            case 1:
+                if (rng() % 2) {
+                    map.emplace<TLevel>(key, i);
+                } else {
+                    map.emplace<TTrackedLevel>(key, alive, i);
+                }
+                expected[key] = i;
+                break;
+            case 2:
+                ASSERT_EQ(map.erase(key), expected.erase(key) > 0);
+                break;
+            case 3: {
+                auto it = map.lower_bound(key);
+                auto expected_it = expected.lower_bound(key);
+                ASSERT_EQ(it == map.end(), expected_it == expected.end());
+                if (expected_it != expected.end()) {
+                    ASSERT_EQ(it.key(), expected_it->first);
+                    ASSERT_EQ(it->Volume(), expected_it->second);
+                }
+                break;
+            }
+            }
+            ASSERT_EQ(map.size(), expected.size());
+        }
+        EXPECT_EQ(Entries(map), (std::vector<std::pair<int, int>>(expected.begin(), expected.end())));
+
+        // erase everything, merging the nodes down to an empty map
+        for (const auto& [key, volume] : expected) {
+            ASSERT_TRUE(map.erase(key));
+        }
+        EXPECT_TRUE(map.empty());
+        EXPECT_EQ(map.begin(), map.end());
+        EXPECT_EQ(alive, 0);
+
+        for (int i = 0; i < 1000; ++i) {
+            map.emplace<TTrackedLevel>(i, alive, i);
+        }
+        sp::btree_map<int, ILevel, std::less<int>, 32, 4> moved = std::move(map);
+        EXPECT_TRUE(map.empty());
+        EXPECT_EQ(moved.size(), 1000);
+        EXPECT_EQ(alive, 1000);
+    }
+    EXPECT_EQ(alive, 0);
+}
+
+} // namespace
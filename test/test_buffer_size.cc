@@ -44,6 +44,11 @@ consteval bool can_emplace() {
     return requires (sp::static_ptr<Base>& p) { p = sp::make_static<Derived>(); };
 }
 
+template<typename To, typename From>
+consteval bool can_convert() {
+    return std::is_constructible_v<To, From&&> && std::is_assignable_v<To&, From&&>;
+}
+
 } // namespace
 
 TEST(BufferSize, DefaultSize) {
@@ -101,3 +106,19 @@ TEST(BufferSize, RedefineBufferSizeInherited) {
     EXPECT_TRUE(sizeof(ILanguage) < sizeof(TCxx));
     EXPECT_TRUE((can_emplace<ILanguage, TCxx>()));
 }
+
+TEST(BufferSize, ExplicitBufferSize) {
+    using TSmall = sp::static_ptr<Animal>;
+    using TLarge = sp::static_ptr<Animal, 2 * sizeof(Cat)>;
+
+    // the bigger buffer may hold a `Cat`, which doesn't fit into the smaller one
+    EXPECT_TRUE((can_convert<TLarge, TSmall>()));
+    EXPECT_FALSE((can_convert<TSmall, TLarge>()));
+    EXPECT_FALSE((can_convert<sp::static_ptr<Animal, sizeof(Cat)>, TLarge>()));
+
+    TLarge large = sp::make_static<Animal>();
+    large.emplace<Cat>();
+    TLarge other = std::move(large);
+    EXPECT_TRUE(other);
+    EXPECT_FALSE(large);
+}
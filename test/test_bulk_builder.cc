@@ -0,0 +1,179 @@
+#include "bulk_builder.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+class IShape {
+public:
+    virtual ~IShape() = default;
+    virtual int Area() const = 0;
+};
+
+struct TRectangleConfig {
+    std::int32_t Width;
+    std::int32_t Height;
+};
+
+class TRectangle : public IShape {
+public:
+    TRectangle(TRectangleConfig config) : Config_{config} {}
+    int Area() const override { return Config_.Width * Config_.Height; }
+
+private:
+    TRectangleConfig Config_;
+};
+
+class TSquare : public IShape {
+public:
+    TSquare(std::int32_t side) : Side_{side} {
+        if (side < 0) {
+            throw std::invalid_argument("negative side");
+        }
+    }
+    int Area() const override { return Side_ * Side_; }
+
+private:
+    std::int32_t Side_;
+};
+
+// counts the constructions
+class TCountedSquare : public TSquare {
+public:
+    TCountedSquare(std::int32_t side) : TSquare{side} {
+        ++Constructed;
+    }
+
+    static inline int Constructed = 0;
+};
+
+// constructed from the raw payload, its area is the payload length
+class TLabel : public IShape {
+public:
+    TLabel(std::span<const std::byte> payload)
+        : Text_{reinterpret_cast<const char*>(payload.data()), payload.size()}
+    {}
+    int Area() const override { return static_cast<int>(Text_.size()); }
+
+private:
+    std::string Text_;
+};
+
+enum ETypeId : std::uint32_t {
+    Rectangle = 1,
+    Square = 2,
+    Label = 3,
+};
+
+using TBuilder = sp::bulk_builder<IShape, 48>;
+
+TBuilder MakeBuilder() {
+    TBuilder builder;
+    builder.register_type<TRectangle, TRectangleConfig>(Rectangle);
+    builder.register_type<TSquare, std::int32_t>(Square);
+    builder.register_type<TLabel>(Label);
+    return builder;
+}
+
+TEST(BulkBuilder, Build) {
+    const auto builder = MakeBuilder();
+
+    sp::bulk_table_writer writer;
+    writer.add(Rectangle, TRectangleConfig{2, 3});
+    writer.add(Square, std::int32_t{4});
+    const std::string text = "hello";
+    writer.add(Label, std::as_bytes(std::span{text}));
+    EXPECT_EQ(writer.size(), 3);
+
+    std::vector<TBuilder::slot_type> shapes;
+    shapes.emplace_back().emplace<TSquare>(1);
+    const auto footprint = builder.build(writer.data(), shapes);
+
+    ASSERT_EQ(shapes.size(), 4);
+    EXPECT_EQ(shapes[0]->Area(), 1);
+    EXPECT_EQ(shapes[1]->Area(), 6);
+    EXPECT_EQ(shapes[2]->Area(), 16);
+    EXPECT_EQ(shapes[3]->Area(), 5);
+
+    EXPECT_EQ(footprint.objects, 3);
+    EXPECT_EQ(footprint.storage_bytes, 3 * sizeof(TBuilder::slot_type));
+    EXPECT_EQ(footprint.object_bytes, sizeof(TRectangle) + sizeof(TSquare) + sizeof(TLabel));
+}
+
+TEST(BulkBuilder, Parallel) {
+    const auto builder = MakeBuilder();
+
+    sp::bulk_table_writer writer;
+    for (std::int32_t i = 0; i < 10000; ++i) {
+        if (i % 2) {
+            writer.add(Square, i);
+        } else {
+            writer.add(Rectangle, TRectangleConfig{i, 2});
+        }
+    }
+
+    std::vector<TBuilder::slot_type> shapes;
+    builder.build(writer.data(), shapes, {.threads = 4, .chunk_size = 100});
+    ASSERT_EQ(shapes.size(), 10000);
+    for (int i = 0; i < 10000; ++i) {
+        EXPECT_EQ(shapes[i]->Area(), i % 2 ? i * i : 2 * i);
+    }
+}
+
+TEST(BulkBuilder, InvalidTable) {
+    const auto builder = MakeBuilder();
+    std::vector<TBuilder::slot_type> shapes;
+
+    sp::bulk_table_writer unknown;
+    unknown.add(Square, std::int32_t{1});
+    unknown.add(42, std::int32_t{1});
+    EXPECT_THROW(builder.build(unknown.data(), shapes), std::invalid_argument);
+    EXPECT_TRUE(shapes.empty());
+
+    sp::bulk_table_writer mismatch;
+    mismatch.add(Square, std::int64_t{1});
+    EXPECT_THROW(builder.build(mismatch.data(), shapes), std::invalid_argument);
+    EXPECT_TRUE(shapes.empty());
+
+    sp::bulk_table_writer truncated;
+    truncated.add(Square, std::int32_t{1});
+    EXPECT_THROW(builder.build(truncated.data().first(6), shapes), std::invalid_argument);
+    EXPECT_THROW(builder.build(truncated.data().first(10), shapes), std::invalid_argument);
+    EXPECT_TRUE(shapes.empty());
+
+    // the bad record at the end is found before anything is built
+    TBuilder counted;
+    counted.register_type<TCountedSquare, std::int32_t>(Square);
+    sp::bulk_table_writer late_mismatch;
+    for (std::int32_t i = 0; i < 100; ++i) {
+        late_mismatch.add(Square, i);
+    }
+    late_mismatch.add(Square, std::int16_t{1});
+    EXPECT_THROW(counted.build(late_mismatch.data(), shapes), std::invalid_argument);
+    EXPECT_EQ(TCountedSquare::Constructed, 0);
+    EXPECT_TRUE(shapes.empty());
+
+    TBuilder duplicate;
+    duplicate.register_type<TSquare, std::int32_t>(Square);
+    EXPECT_THROW((duplicate.register_type<TSquare, std::int32_t>(Square)), std::invalid_argument);
+}
+
+TEST(BulkBuilder, ThrowingConstructor) {
+    const auto builder = MakeBuilder();
+
+    sp::bulk_table_writer writer;
+    for (std::int32_t i = 0; i < 1000; ++i) {
+        writer.add(Square, i == 700 ? -1 : i);
+    }
+
+    std::vector<TBuilder::slot_type> shapes;
+    shapes.emplace_back().emplace<TSquare>(3);
+    EXPECT_THROW(builder.build(writer.data(), shapes, {.threads = 2, .chunk_size = 64}), std::invalid_argument);
+    ASSERT_EQ(shapes.size(), 1);
+    EXPECT_EQ(shapes[0]->Area(), 9);
+}
+
+} // namespace
@@ -0,0 +1,123 @@
+#include "concurrent_map.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class IHandler {
+public:
+    virtual ~IHandler() = default;
+    virtual int Handle(int request) const = 0;
+};
+
+class TEchoHandler : public IHandler {
+public:
+    int Handle(int request) const override { return request; }
+};
+
+class TScaleHandler : public IHandler {
+public:
+    TScaleHandler(int scale) : Scale_{scale} {}
+    int Handle(int request) const override { return request * Scale_; }
+    void SetScale(int scale) { Scale_ = scale; }
+
+private:
+    int Scale_;
+};
+
+using THandlers = sp::concurrent_map<std::string, IHandler>;
+
+int Call(const THandlers& handlers, const std::string& name, int request) {
+    int result = -1;
+    handlers.visit(name, [&](const IHandler& handler) { result = handler.Handle(request); });
+    return result;
+}
+
+} // namespace
+
+TEST(ConcurrentMap, Basic) {
+    THandlers handlers;
+    handlers.emplace<TEchoHandler>("echo");
+    EXPECT_TRUE(handlers.try_emplace<TScaleHandler>("double", 2));
+    EXPECT_FALSE(handlers.try_emplace<TScaleHandler>("double", 3));
+    EXPECT_EQ(handlers.size(), 2);
+
+    EXPECT_EQ(Call(handlers, "echo", 5), 5);
+    EXPECT_EQ(Call(handlers, "double", 5), 10);
+    EXPECT_EQ(Call(handlers, "missing", 5), -1);
+    EXPECT_FALSE(handlers.contains("missing"));
+
+    // replace the value in place
+    handlers.emplace<TScaleHandler>("echo", 7);
+    EXPECT_EQ(Call(handlers, "echo", 5), 35);
+    EXPECT_EQ(handlers.size(), 2);
+
+    handlers.visit_exclusive("double", [](IHandler& handler) {
+        static_cast<TScaleHandler&>(handler).SetScale(4);
+    });
+    EXPECT_EQ(Call(handlers, "double", 5), 20);
+
+    EXPECT_TRUE(handlers.erase("echo"));
+    EXPECT_FALSE(handlers.erase("echo"));
+    EXPECT_FALSE(handlers.contains("echo"));
+    EXPECT_EQ(handlers.size(), 1);
+}
+
+TEST(ConcurrentMap, GrowthAndErasure) {
+    sp::concurrent_map<int, IHandler, std::hash<int>, 4> handlers;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 10000; ++i) {
+            handlers.emplace<TScaleHandler>(i, i);
+        }
+        EXPECT_EQ(handlers.size(), 10000);
+        for (int i = 0; i < 10000; i += 2) {
+            EXPECT_TRUE(handlers.erase(i));
+        }
+        EXPECT_EQ(handlers.size(), 5000);
+        for (int i = 0; i < 10000; ++i) {
+            int result = 0;
+            const bool found = handlers.visit(i, [&](const IHandler& handler) { result = handler.Handle(1); });
+            EXPECT_EQ(found, i % 2 == 1);
+            if (found) {
+                EXPECT_EQ(result, i);
+            }
+        }
+    }
+}
+
+TEST(ConcurrentMap, ConcurrentAccess) {
+    sp::concurrent_map<int, IHandler> handlers;
+    for (int i = 0; i < 1000; ++i) {
+        handlers.emplace<TEchoHandler>(i);
+    }
+
+    std::atomic<int> errors{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 20000; ++i) {
+                const int key = (i * 7 + t) % 1000;
+                if (i % 10 == 0) {
+                    handlers.emplace<TScaleHandler>(key, 1);
+                } else {
+                    bool found = handlers.visit(key, [&](const IHandler& handler) {
+                        if (handler.Handle(key) != key) {
+                            ++errors;
+                        }
+                    });
+                    if (!found) {
+                        ++errors;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(errors, 0);
+    EXPECT_EQ(handlers.size(), 1000);
+}
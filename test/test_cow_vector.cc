@@ -0,0 +1,139 @@
+#include "cow_vector.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int Copies = 0;
+
+class IStrategy {
+public:
+    IStrategy(int limit) : Limit_{limit} {}
+    IStrategy(const IStrategy& strategy) : Limit_{strategy.Limit_} {
+        ++Copies;
+    }
+    IStrategy& operator=(const IStrategy&) = default;
+    virtual ~IStrategy() = default;
+    virtual int Limit() const { return Limit_; }
+    void SetLimit(int limit) { Limit_ = limit; }
+
+protected:
+    int Limit_;
+};
+
+class TDoubledStrategy : public IStrategy {
+public:
+    using IStrategy::IStrategy;
+    int Limit() const override { return 2 * Limit_; }
+};
+
+// non-copyable strategies can't be stored
+class TUniqueStrategy : public IStrategy {
+public:
+    using IStrategy::IStrategy;
+    TUniqueStrategy(const TUniqueStrategy&) = delete;
+};
+
+using TStrategies = sp::cow_vector<IStrategy, 4>;
+
+std::vector<int> Limits(const TStrategies::snapshot& snapshot) {
+    std::vector<int> limits;
+    for (const auto& strategy : snapshot) {
+        limits.push_back(strategy.Limit());
+    }
+    return limits;
+}
+
+template<typename Derived>
+consteval bool can_emplace() {
+    return requires (TStrategies& v) { v.emplace_back<Derived>(1); };
+}
+
+} // namespace
+
+TEST(CowVector, SnapshotsAreImmutable) {
+    TStrategies strategies;
+    const auto empty = strategies.load();
+    for (int i = 0; i < 10; ++i) {
+        if (i % 2 == 0) {
+            strategies.emplace_back(i);
+        } else {
+            strategies.emplace_back<TDoubledStrategy>(i);
+        }
+    }
+    EXPECT_TRUE(empty->empty());
+    EXPECT_EQ(strategies.size(), 10);
+
+    const auto before = strategies.load();
+    strategies.modify(5, [](IStrategy& strategy) { strategy.SetLimit(100); });
+    strategies.emplace<TDoubledStrategy>(0, 50);
+    strategies.pop_back();
+    const auto after = strategies.load();
+
+    EXPECT_EQ(Limits(*before), (std::vector<int>{0, 2, 2, 6, 4, 10, 6, 14, 8, 18}));
+    EXPECT_EQ(Limits(*after), (std::vector<int>{100, 2, 2, 6, 4, 200, 6, 14, 8}));
+    EXPECT_EQ((*after)[5].Limit(), 200);
+}
+
+TEST(CowVector, OnlyModifiedChunkIsCopied) {
+    TStrategies strategies;
+    for (int i = 0; i < 12; ++i) {
+        strategies.emplace_back(i);
+    }
+    const auto before = strategies.load();
+
+    Copies = 0;
+    strategies.modify(5, [](IStrategy& strategy) { strategy.SetLimit(-5); });
+    EXPECT_EQ(Copies, 4);
+
+    const auto after = strategies.load();
+    EXPECT_TRUE(after->shares_chunk(*before, 0));
+    EXPECT_FALSE(after->shares_chunk(*before, 5));
+    EXPECT_TRUE(after->shares_chunk(*before, 11));
+}
+
+TEST(CowVector, CopyableTypes) {
+    EXPECT_TRUE(can_emplace<IStrategy>());
+    EXPECT_TRUE(can_emplace<TDoubledStrategy>());
+    EXPECT_FALSE(can_emplace<TUniqueStrategy>());
+}
+
+TEST(CowVector, ConcurrentReaders) {
+    TStrategies strategies;
+    for (int i = 0; i < 100; ++i) {
+        strategies.emplace_back(1);
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<int> inconsistent{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            while (!done) {
+                // the writer updates limits in order, so every version has
+                // a prefix of new limits and a suffix of old limits
+                const auto snapshot = strategies.load();
+                const int first = (*snapshot)[0].Limit();
+                for (const auto& strategy : *snapshot) {
+                    if (strategy.Limit() != first && strategy.Limit() != first - 1) {
+                        ++inconsistent;
+                    }
+                }
+            }
+        });
+    }
+
+    for (int limit = 2; limit < 50; ++limit) {
+        for (int pos = 0; pos < 100; ++pos) {
+            strategies.modify(pos, [limit](IStrategy& strategy) { strategy.SetLimit(limit); });
+        }
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(inconsistent, 0);
+    EXPECT_EQ(Limits(*strategies.load()), std::vector<int>(100, 49));
+}
@@ -0,0 +1,124 @@
+#define STATIC_PTR_PROFILE
+#include "static_ptr.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class IShape {
+public:
+    virtual ~IShape() = default;
+    virtual int Area() const = 0;
+};
+
+class TSquare : public IShape {
+public:
+    int Area() const override { return 4; }
+};
+
+class TCircle : public IShape {
+public:
+    int Area() const override { return 3; }
+};
+
+using TShapes = std::vector<sp::static_ptr<IShape>>;
+
+TShapes MakeShapes(int squares, int circles) {
+    TShapes shapes;
+    for (int i = 0; i < squares; ++i) {
+        shapes.emplace_back().emplace<TSquare>();
+    }
+    for (int i = 0; i < circles; ++i) {
+        shapes.emplace_back().emplace<TCircle>();
+    }
+    return shapes;
+}
+
+// each of these functions is a single call site
+[[gnu::noinline]] int MonomorphicSite(const TShapes& shapes) {
+    int area = 0;
+    for (const auto& shape : shapes) {
+        area += shape->Area();
+    }
+    return area;
+}
+
+[[gnu::noinline]] int PolymorphicSite(const TShapes& shapes) {
+    int area = 0;
+    for (const auto& shape : shapes) {
+        area += shape->Area();
+    }
+    return area;
+}
+
+class DispatchProfile : public testing::Test {
+protected:
+    void SetUp() override {
+        sp::set_dispatch_sample_period(1);
+        sp::clear_dispatch_samples();
+    }
+};
+
+TEST_F(DispatchProfile, Entropy) {
+    MonomorphicSite(MakeShapes(30, 0));
+    PolymorphicSite(MakeShapes(10, 10));
+
+    const auto report = sp::dispatch_report();
+    ASSERT_EQ(report.size(), 2);
+
+    EXPECT_EQ(report[0].samples, 30);
+    EXPECT_EQ(*report[0].base, typeid(IShape));
+    EXPECT_DOUBLE_EQ(report[0].entropy, 0.0);
+    ASSERT_EQ(report[0].types.size(), 1);
+    EXPECT_EQ(*report[0].types[0].first, typeid(TSquare));
+
+    EXPECT_EQ(report[1].samples, 20);
+    EXPECT_DOUBLE_EQ(report[1].entropy, 1.0);
+    ASSERT_EQ(report[1].types.size(), 2);
+    EXPECT_NE(report[0].site, report[1].site);
+
+    std::stringstream out;
+    sp::print_dispatch_report(out, report);
+    EXPECT_NE(out.str().find("entropy 1.000"), std::string::npos);
+    // the format of the stream is kept
+    EXPECT_EQ(out.flags(), std::stringstream{}.flags());
+    EXPECT_EQ(out.precision(), std::stringstream{}.precision());
+}
+
+TEST_F(DispatchProfile, Sampling) {
+    sp::set_dispatch_sample_period(10);
+    const auto shapes = MakeShapes(500, 500);
+    for (int i = 0; i < 10; ++i) {
+        PolymorphicSite(shapes);
+    }
+    const auto samples = sp::collect_dispatch_samples();
+    EXPECT_EQ(samples.size(), 1000);
+
+    // empty pointers are skipped
+    sp::set_dispatch_sample_period(1);
+    sp::clear_dispatch_samples();
+    sp::static_ptr<IShape> empty;
+    EXPECT_EQ(empty.operator->(), nullptr);
+    EXPECT_TRUE(sp::collect_dispatch_samples().empty());
+}
+
+TEST_F(DispatchProfile, Threads) {
+    const auto shapes = MakeShapes(100, 0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&] { MonomorphicSite(shapes); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // the samples of finished threads are kept
+    const auto report = sp::dispatch_report();
+    ASSERT_EQ(report.size(), 1);
+    EXPECT_EQ(report[0].samples, 400);
+    EXPECT_EQ(sp::dropped_dispatch_samples(), 0);
+}
+
+} // namespace
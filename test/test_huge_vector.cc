@@ -0,0 +1,139 @@
+#include "huge_vector.h"
+#include <gtest/gtest.h>
+#include <string>
+
+namespace {
+
+struct TCounters {
+    int Moves = 0;
+    int Destructions = 0;
+};
+
+class IShape {
+public:
+    IShape(TCounters& counters) : Counters_{&counters} {}
+    IShape(IShape&& shape) : Counters_{shape.Counters_} {
+        ++Counters_->Moves;
+    }
+    virtual ~IShape() {
+        ++Counters_->Destructions;
+    }
+    virtual int Area() const = 0;
+
+protected:
+    TCounters* Counters_;
+};
+
+class TSquare : public IShape {
+public:
+    TSquare(TCounters& counters, int side) : IShape{counters}, Side_{side} {}
+    int Area() const override { return Side_ * Side_; }
+
+private:
+    int Side_;
+};
+
+class TRectangle : public IShape {
+public:
+    TRectangle(TCounters& counters, int width, int height) : IShape{counters}, Width_{width}, Height_{height} {}
+    int Area() const override { return Width_ * Height_; }
+
+private:
+    int Width_;
+    int Height_;
+};
+
+// non-polymorphic class with a self-pointer
+struct TSelfReferencing {
+    TSelfReferencing() = default;
+    TSelfReferencing(const TSelfReferencing&) {}
+    TSelfReferencing* Self = this;
+};
+
+// trivially copyable base of a type that is not relocatable
+struct TPlainBase {
+    int Id = 0;
+};
+
+struct TNamed : TPlainBase {
+    std::string Name{"short"};
+};
+
+} // namespace
+
+STATIC_PTR_BUFFER_SIZE(IShape, 32)
+STATIC_PTR_TRIVIALLY_RELOCATABLE(IShape)
+
+TEST(HugeVector, RelocatableTraits) {
+    EXPECT_TRUE(sp::is_trivially_relocatable_v<int>);
+    EXPECT_TRUE(sp::is_trivially_relocatable_v<TSquare>);
+    EXPECT_TRUE(sp::is_trivially_relocatable_v<sp::static_ptr<IShape>>);
+    EXPECT_TRUE(sp::is_trivially_relocatable_v<sp::static_ptr<int>>);
+    EXPECT_FALSE(sp::is_trivially_relocatable_v<TSelfReferencing>);
+    EXPECT_FALSE(sp::is_trivially_relocatable_v<sp::static_ptr<TSelfReferencing>>);
+    // the stored object may be any derived type
+    EXPECT_TRUE(sp::is_trivially_relocatable_v<TPlainBase>);
+    EXPECT_FALSE((sp::is_trivially_relocatable_v<sp::static_ptr<TPlainBase, 64>>));
+}
+
+TEST(HugeVector, Scalars) {
+    sp::huge_vector<int> v;
+    EXPECT_TRUE(v.empty());
+    for (int i = 0; i < 1000000; ++i) {
+        v.push_back(std::move(i));
+    }
+    EXPECT_EQ(v.size(), 1000000);
+    EXPECT_GE(v.capacity(), v.size());
+    for (int i = 0; i < 1000000; ++i) {
+        ASSERT_EQ(v[i], i);
+    }
+    v.pop_back();
+    EXPECT_EQ(v.back(), 999998);
+}
+
+TEST(HugeVector, GrowthDoesNotMoveObjects) {
+    TCounters counters;
+    constexpr int count = 200000;
+    {
+        sp::huge_vector<sp::static_ptr<IShape>> v;
+        for (int i = 0; i < count; ++i) {
+            if (i % 2 == 0) {
+                v.emplace_back().emplace<TSquare>(counters, i % 10);
+            } else {
+                v.emplace_back().emplace<TRectangle>(counters, i % 10, 2);
+            }
+        }
+        EXPECT_EQ(counters.Moves, 0);
+        EXPECT_EQ(counters.Destructions, 0);
+
+        long long area = 0;
+        for (const auto& shape : v) {
+            area += shape->Area();
+        }
+        long long expected = 0;
+        for (int i = 0; i < count; ++i) {
+            expected += i % 2 == 0 ? (i % 10) * (i % 10) : (i % 10) * 2;
+        }
+        EXPECT_EQ(area, expected);
+
+        sp::huge_vector<sp::static_ptr<IShape>> moved = std::move(v);
+        EXPECT_TRUE(v.empty());
+        EXPECT_EQ(moved.size(), count);
+    }
+    EXPECT_EQ(counters.Moves, 0);
+    EXPECT_EQ(counters.Destructions, count);
+}
+
+TEST(HugeVector, Reserve) {
+    sp::huge_vector<sp::static_ptr<IShape>> v(1000);
+    EXPECT_GE(v.capacity(), 1000);
+    const auto* data = v.data();
+    TCounters counters;
+    for (int i = 0; i < 1000; ++i) {
+        v.emplace_back(sp::make_static<TSquare>(counters, 1));
+    }
+    EXPECT_EQ(v.data(), data);
+    v.clear();
+    EXPECT_TRUE(v.empty());
+    EXPECT_EQ(counters.Destructions, 1000);  // temporaries are relocated bytewise
+}
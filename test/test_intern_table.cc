@@ -0,0 +1,180 @@
+#include "intern_table.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class IConfig {
+public:
+    virtual ~IConfig() = default;
+    virtual int TickSize() const = 0;
+};
+
+class TFuturesConfig : public IConfig {
+public:
+    TFuturesConfig(int tickSize, int lotSize) : TickSize_{tickSize}, LotSize_{lotSize} {}
+    int TickSize() const override { return TickSize_; }
+    int LotSize() const { return LotSize_; }
+
+    bool operator==(const TFuturesConfig& rhs) const {
+        return TickSize_ == rhs.TickSize_ && LotSize_ == rhs.LotSize_;
+    }
+
+private:
+    int TickSize_;
+    int LotSize_;
+};
+
+class TOptionsConfig : public IConfig {
+public:
+    TOptionsConfig(int tickSize) : TickSize_{tickSize} {}
+    int TickSize() const override { return TickSize_; }
+
+    bool operator==(const TOptionsConfig& rhs) const {
+        return TickSize_ == rhs.TickSize_;
+    }
+
+private:
+    int TickSize_;
+};
+
+// config whose move constructor may throw, the flag is not a part of the value
+class TFlakyConfig : public IConfig {
+public:
+    TFlakyConfig(int tickSize, bool throwOnMove) : TickSize_{tickSize}, ThrowOnMove_{throwOnMove} {
+        ++Alive;
+    }
+    TFlakyConfig(TFlakyConfig&& rhs) : TickSize_{rhs.TickSize_}, ThrowOnMove_{rhs.ThrowOnMove_} {
+        if (ThrowOnMove_) {
+            throw std::runtime_error("move failed");
+        }
+        ++Alive;
+    }
+    ~TFlakyConfig() {
+        --Alive;
+    }
+    int TickSize() const override { return TickSize_; }
+
+    bool operator==(const TFlakyConfig& rhs) const {
+        return TickSize_ == rhs.TickSize_;
+    }
+
+    static inline int Alive = 0;
+
+private:
+    int TickSize_;
+    bool ThrowOnMove_;
+};
+
+} // namespace
+
+template<>
+struct std::hash<TFlakyConfig> {
+    std::size_t operator()(const TFlakyConfig& config) const {
+        return std::hash<int>{}(config.TickSize());
+    }
+};
+
+// hooks for the config types
+template<>
+struct sp::intern_traits<TFuturesConfig> {
+    static std::size_t hash(const TFuturesConfig& config) {
+        return std::hash<int>{}(config.TickSize()) * 31 + std::hash<int>{}(config.LotSize());
+    }
+
+    static bool equal(const TFuturesConfig& lhs, const TFuturesConfig& rhs) {
+        return lhs == rhs;
+    }
+};
+
+template<>
+struct sp::intern_traits<TOptionsConfig> {
+    static std::size_t hash(const TOptionsConfig& config) {
+        return std::hash<int>{}(config.TickSize());
+    }
+
+    static bool equal(const TOptionsConfig& lhs, const TOptionsConfig& rhs) {
+        return lhs == rhs;
+    }
+};
+
+STATIC_PTR_INHERITED_BUFFER_SIZE(IConfig, 32)
+
+TEST(InternTable, EqualValuesAreStoredOnce) {
+    sp::intern_table<IConfig> table;
+    const auto a = table.intern<TFuturesConfig>(5, 100);
+    const auto b = table.intern<TFuturesConfig>(5, 100);
+    const auto c = table.intern<TFuturesConfig>(5, 10);
+    EXPECT_TRUE(a);
+    EXPECT_TRUE(a == b);
+    EXPECT_FALSE(a == c);
+    EXPECT_EQ(table.size(), 2);
+    EXPECT_EQ(&table[a], &table[b]);
+    EXPECT_EQ(table[c].TickSize(), 5);
+    EXPECT_EQ(static_cast<const TFuturesConfig&>(table[c]).LotSize(), 10);
+    EXPECT_FALSE(sp::interned<IConfig>{});
+}
+
+TEST(InternTable, TypesAreNotMixedUp) {
+    sp::intern_table<IConfig> table;
+    const auto futures = table.intern<TFuturesConfig>(1, 0);
+    const auto options = table.intern<TOptionsConfig>(1);
+    EXPECT_FALSE(futures == options);
+    EXPECT_EQ(table.size(), 2);
+    EXPECT_TRUE(dynamic_cast<const TOptionsConfig*>(&table[options]) != nullptr);
+}
+
+TEST(InternTable, ThrowingMove) {
+    {
+        sp::intern_table<IConfig> table;
+        const auto a = table.intern<TOptionsConfig>(1);
+        EXPECT_THROW(table.intern<TFlakyConfig>(5, true), std::runtime_error);
+        EXPECT_EQ(table.size(), 1);
+        EXPECT_EQ(TFlakyConfig::Alive, 0);
+
+        // the failed value is not found, the equal one is stored in its slot
+        const auto b = table.intern<TFlakyConfig>(5, false);
+        EXPECT_EQ(b.index(), 1);
+        EXPECT_EQ(table[b].TickSize(), 5);
+        EXPECT_TRUE(b == table.intern<TFlakyConfig>(5, false));
+        EXPECT_EQ(table[a].TickSize(), 1);
+        EXPECT_EQ(TFlakyConfig::Alive, 1);
+    }
+    EXPECT_EQ(TFlakyConfig::Alive, 0);
+}
+
+TEST(InternTable, ManyValues) {
+    sp::intern_table<IConfig> table;
+    std::vector<sp::interned<IConfig>> handles;
+    for (int i = 0; i < 5000; ++i) {
+        handles.push_back(table.intern<TOptionsConfig>(i % 3000));
+    }
+    EXPECT_EQ(table.size(), 3000);
+    for (int i = 0; i < 5000; ++i) {
+        EXPECT_EQ(table[handles[i]].TickSize(), i % 3000);
+        EXPECT_TRUE(handles[i] == handles[i % 3000]);
+    }
+}
+
+TEST(InternTable, ConcurrentInterning) {
+    sp::intern_table<IConfig> table;
+    std::vector<std::vector<sp::interned<IConfig>>> handles(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&table, &result = handles[t]] {
+            for (int i = 0; i < 2000; ++i) {
+                result.push_back(table.intern<TFuturesConfig>(i % 500, 1));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(table.size(), 500);
+    for (int t = 1; t < 4; ++t) {
+        EXPECT_EQ(handles[t], handles[0]);
+    }
+}
@@ -0,0 +1,199 @@
+#include "lru_cache.h"
+#include <gtest/gtest.h>
+#include <list>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+class IPricer {
+public:
+    virtual ~IPricer() = default;
+    virtual int Price() const = 0;
+};
+
+class TFixed : public IPricer {
+public:
+    TFixed(int price) : Price_{price} {}
+    int Price() const override { return Price_; }
+
+private:
+    int Price_;
+};
+
+class TTracked : public IPricer {
+public:
+    TTracked(int& alive, int price) : Alive_{alive}, Price_{price} {
+        if (price < 0) {
+            throw std::invalid_argument("negative price");
+        }
+        ++Alive_;
+    }
+    ~TTracked() {
+        --Alive_;
+    }
+    int Price() const override { return Price_; }
+
+private:
+    int& Alive_;
+    int Price_;
+    char Padding_[32] = {};
+};
+
+// key whose copy throws when asked to
+struct TFlakyKey {
+    int Id = 0;
+    bool ThrowOnCopy = false;
+
+    TFlakyKey(int id, bool throwOnCopy = false) : Id{id}, ThrowOnCopy{throwOnCopy} {}
+    TFlakyKey(const TFlakyKey& rhs) : Id{rhs.Id}, ThrowOnCopy{rhs.ThrowOnCopy} {
+        if (ThrowOnCopy) {
+            throw std::runtime_error("copy failed");
+        }
+    }
+    TFlakyKey& operator=(const TFlakyKey&) = default;
+
+    bool operator==(const TFlakyKey& rhs) const { return Id == rhs.Id; }
+};
+
+struct TFlakyKeyHash {
+    std::size_t operator()(const TFlakyKey& key) const { return std::hash<int>{}(key.Id); }
+};
+
+using TCache = sp::lru_cache<std::string, IPricer, std::hash<std::string>, 64>;
+
+std::vector<std::string> Keys(TCache& cache) {
+    std::vector<std::string> keys;
+    cache.for_each([&](const std::string& key, IPricer&) { keys.push_back(key); });
+    return keys;
+}
+
+TEST(LruCache, Eviction) {
+    TCache cache(3);
+    cache.emplace<TFixed>("a", 1);
+    cache.emplace<TFixed>("b", 2);
+    cache.emplace<TFixed>("c", 3);
+    EXPECT_EQ(Keys(cache), (std::vector<std::string>{"c", "b", "a"}));
+
+    ASSERT_NE(cache.get("a"), nullptr);
+    EXPECT_EQ(cache.get("a")->Price(), 1);
+    EXPECT_EQ(Keys(cache), (std::vector<std::string>{"a", "c", "b"}));
+
+    // peek doesn't touch the recency
+    EXPECT_EQ(cache.peek("b")->Price(), 2);
+    cache.emplace<TFixed>("d", 4);
+    EXPECT_EQ(Keys(cache), (std::vector<std::string>{"d", "a", "c"}));
+    EXPECT_FALSE(cache.contains("b"));
+    EXPECT_EQ(cache.get("b"), nullptr);
+    EXPECT_EQ(cache.size(), 3);
+
+    // replacing a value makes it the most recent one
+    cache.emplace<TFixed>("c", 30);
+    EXPECT_EQ(Keys(cache), (std::vector<std::string>{"c", "d", "a"}));
+    EXPECT_EQ(cache.get("c")->Price(), 30);
+
+    EXPECT_TRUE(cache.erase("d"));
+    EXPECT_FALSE(cache.erase("d"));
+    EXPECT_EQ(Keys(cache), (std::vector<std::string>{"c", "a"}));
+}
+
+TEST(LruCache, Bytes) {
+    int alive = 0;
+    {
+        TCache cache(100, 3 * sizeof(TTracked) + sizeof(TFixed));
+        for (int i = 0; i < 10; ++i) {
+            cache.emplace<TTracked>(std::to_string(i), alive, i);
+        }
+        EXPECT_EQ(cache.size(), 3);
+        EXPECT_EQ(alive, 3);
+        EXPECT_EQ(cache.bytes(), 3 * sizeof(TTracked));
+
+        cache.emplace<TFixed>("fixed", 1);
+        EXPECT_EQ(cache.size(), 4);
+        EXPECT_EQ(cache.bytes(), cache.max_bytes());
+
+        cache.emplace<TTracked>("big", alive, 1);
+        EXPECT_EQ(alive, 3);
+        EXPECT_FALSE(cache.contains("7"));
+        EXPECT_TRUE(cache.contains("fixed"));
+
+        EXPECT_THROW((sp::lru_cache<int, IPricer, std::hash<int>, 64>(10, 8).emplace<TTracked>(1, alive, 1)), std::length_error);
+    }
+    EXPECT_EQ(alive, 0);
+}
+
+TEST(LruCache, ThrowingConstructor) {
+    int alive = 0;
+    TCache cache(2);
+    cache.emplace<TTracked>("a", alive, 1);
+    EXPECT_THROW(cache.emplace<TTracked>("b", alive, -1), std::invalid_argument);
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_FALSE(cache.contains("b"));
+    cache.emplace<TTracked>("b", alive, 2);
+    cache.emplace<TTracked>("c", alive, 3);
+    EXPECT_EQ(Keys(cache), (std::vector<std::string>{"c", "b"}));
+    cache.clear();
+    EXPECT_TRUE(cache.empty());
+    EXPECT_EQ(alive, 0);
+}
+
+TEST(LruCache, ThrowingKeyCopy) {
+    int alive = 0;
+    {
+        sp::lru_cache<TFlakyKey, IPricer, TFlakyKeyHash, 64> cache(2);
+        cache.emplace<TTracked>(TFlakyKey{1}, alive, 1);
+        EXPECT_THROW(cache.emplace<TTracked>(TFlakyKey{2, true}, alive, 2), std::runtime_error);
+        EXPECT_EQ(cache.size(), 1);
+        EXPECT_EQ(alive, 1);
+        EXPECT_FALSE(cache.contains(TFlakyKey{2}));
+
+        // the capacity is intact
+        cache.emplace<TTracked>(TFlakyKey{2}, alive, 2);
+        cache.emplace<TTracked>(TFlakyKey{3}, alive, 3);
+        EXPECT_EQ(cache.size(), 2);
+        EXPECT_EQ(alive, 2);
+        EXPECT_EQ(cache.get(TFlakyKey{3})->Price(), 3);
+        EXPECT_FALSE(cache.contains(TFlakyKey{1}));
+    }
+    EXPECT_EQ(alive, 0);
+}
+
+// compare with a straightforward LRU on random operations
+TEST(LruCache, Random) {
+    constexpr std::size_t capacity = 50;
+    sp::lru_cache<int, IPricer> cache(capacity);
+    std::list<int> order;
+    std::unordered_map<int, int> values;
+
+    std::mt19937 rng{42};
+    for (int i = 0; i < 100000; ++i) {
+        const int key = static_cast<int>(rng() % 200);
+        if (rng() % 4 == 0) {
+            EXPECT_EQ(cache.erase(key), values.erase(key) > 0);
+            order.remove(key);
+        } else if (rng() % 2) {
+            auto* value = cache.get(key);
+            ASSERT_EQ(value != nullptr, values.contains(key));
+            if (value) {
+                EXPECT_EQ(value->Price(), values[key]);
+                order.remove(key);
+                order.push_front(key);
+            }
+        } else {
+            cache.emplace<TFixed>(key, i);
+            order.remove(key);
+            order.push_front(key);
+            values[key] = i;
+            if (order.size() > capacity) {
+                values.erase(order.back());
+                order.pop_back();
+            }
+        }
+        ASSERT_EQ(cache.size(), order.size());
+    }
+}
+
+} // namespace
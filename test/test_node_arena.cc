@@ -0,0 +1,181 @@
+#include "node_arena.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+class IRule {
+public:
+    virtual ~IRule() = default;
+    virtual std::string Name() const = 0;
+};
+
+class TAll : public IRule {
+public:
+    std::string Name() const override { return "all"; }
+};
+
+class TMatch : public IRule {
+public:
+    TMatch(std::string pattern) : Pattern_{std::move(pattern)} {
+        if (Pattern_.empty()) {
+            throw std::invalid_argument("empty pattern");
+        }
+    }
+    std::string Name() const override { return Pattern_; }
+
+private:
+    std::string Pattern_;
+};
+
+using TArena = sp::node_arena<IRule, 48>;
+
+std::string PreOrder(const TArena& arena) {
+    std::string names;
+    arena.for_each_depth_first([&](TArena::handle h) {
+        names += arena[h].Name();
+        names += ' ';
+    });
+    return names;
+}
+
+std::string Children(const TArena& arena, TArena::handle h) {
+    std::string names;
+    arena.for_each_child(h, [&](TArena::handle child) {
+        names += arena[child].Name();
+    });
+    return names;
+}
+
+TEST(NodeArena, Add) {
+    TArena arena;
+    const auto root = arena.add<TAll>({});
+    const auto a = arena.add<TMatch>(root, "a");
+    const auto b = arena.add<TMatch>(root, "b");
+    arena.add<TMatch>(a, "c");
+    arena.add<TMatch>({}, "d");
+
+    EXPECT_EQ(arena.size(), 5);
+    EXPECT_EQ(sizeof(TArena::handle), 4);
+    EXPECT_EQ(arena.first_root(), root);
+    EXPECT_EQ(arena.parent(b), root);
+    EXPECT_FALSE(arena.parent(root));
+    EXPECT_EQ(arena.first_child(root), a);
+    EXPECT_EQ(arena.next_sibling(a), b);
+    EXPECT_FALSE(arena.next_sibling(b));
+    EXPECT_EQ(Children(arena, root), "ab");
+    EXPECT_EQ(PreOrder(arena), "all a c b d ");
+
+    // a failed node is unlinked
+    EXPECT_THROW(arena.add<TMatch>(root, ""), std::invalid_argument);
+    EXPECT_EQ(arena.size(), 5);
+    EXPECT_EQ(Children(arena, root), "ab");
+
+    arena.clear();
+    EXPECT_TRUE(arena.empty());
+    EXPECT_FALSE(arena.first_root());
+    EXPECT_EQ(PreOrder(arena), "");
+}
+
+TEST(NodeArena, Build) {
+    constexpr auto root = TArena::no_parent();
+    const std::vector<std::uint32_t> parents = {root, 0, 0, 1, root, 4};
+    const std::vector<std::string> names = {"all", "a", "b", "c", "all", "d"};
+
+    TArena arena;
+    arena.add<TMatch>({}, "x");
+    const auto first = arena.build(parents, [&](TArena::node_ptr& node, std::size_t i) {
+        if (names[i] == "all") {
+            node.emplace<TAll>();
+        } else {
+            node.emplace<TMatch>(names[i]);
+        }
+    });
+    EXPECT_EQ(first.index(), 1);
+    EXPECT_EQ(arena.size(), 7);
+    EXPECT_EQ(PreOrder(arena), "x all a c b all d ");
+
+    const std::vector<std::uint32_t> forward = {root, 2};
+    EXPECT_THROW(arena.build(forward, [](TArena::node_ptr&, std::size_t) {}), std::invalid_argument);
+
+    // the batch is rolled back if a node throws
+    EXPECT_THROW(arena.build(parents, [&](TArena::node_ptr& node, std::size_t i) {
+        node.emplace<TMatch>(i == 3 ? "" : names[i]);
+    }), std::invalid_argument);
+    EXPECT_EQ(arena.size(), 7);
+    EXPECT_EQ(PreOrder(arena), "x all a c b all d ");
+}
+
+TEST(NodeArena, WideRollback) {
+    TArena arena;
+    const auto root = arena.add<TAll>({});
+    arena.add<TMatch>(root, "a");
+    arena.add<TMatch>(root, "b");
+    arena.add<TMatch>({}, "r");
+
+    // many siblings under old and new parents, the last node throws
+    std::vector<std::uint32_t> parents;
+    for (std::uint32_t i = 0; i < 20000; ++i) {
+        parents.push_back(i % 3 == 0 ? TArena::no_parent() : (i % 3 == 1 ? 0 : i - 1));
+    }
+    EXPECT_THROW(arena.build(parents, [&](TArena::node_ptr& node, std::size_t i) {
+        node.emplace<TMatch>(i + 1 == parents.size() ? "" : "n");
+    }), std::invalid_argument);
+    EXPECT_EQ(arena.size(), 4);
+    EXPECT_EQ(PreOrder(arena), "all a b r ");
+
+    // the links are intact, new nodes go to the right places
+    arena.add<TMatch>(root, "c");
+    arena.add<TMatch>({}, "s");
+    EXPECT_EQ(Children(arena, root), "abc");
+    EXPECT_EQ(PreOrder(arena), "all a b c r s ");
+}
+
+TEST(NodeArena, Move) {
+    TArena arena;
+    const auto root = arena.add<TAll>({});
+    arena.add<TMatch>(root, "a");
+
+    TArena moved = std::move(arena);
+    EXPECT_TRUE(arena.empty());
+    EXPECT_FALSE(arena.first_root());
+    EXPECT_EQ(PreOrder(arena), "");
+    EXPECT_EQ(PreOrder(moved), "all a ");
+
+    arena.add<TMatch>({}, "x");
+    EXPECT_EQ(PreOrder(arena), "x ");
+    arena = std::move(moved);
+    EXPECT_EQ(PreOrder(arena), "all a ");
+    EXPECT_FALSE(moved.first_root());
+    EXPECT_EQ(PreOrder(moved), "");
+}
+
+TEST(NodeArena, Relayout) {
+    TArena arena;
+    const auto root = arena.add<TAll>({});
+    const auto a = arena.add<TMatch>(root, "a");
+    const auto b = arena.add<TMatch>(root, "b");
+    const auto c = arena.add<TMatch>(a, "c");
+    const auto d = arena.add<TMatch>(b, "d");
+    arena.add<TMatch>(c, "e");
+
+    const std::string before = PreOrder(arena);
+    const auto remap = arena.relayout();
+    EXPECT_EQ(PreOrder(arena), before);
+
+    // the pre-order is the order of the arena now
+    std::vector<std::uint32_t> indices;
+    arena.for_each_depth_first([&](TArena::handle h) { indices.push_back(h.index()); });
+    EXPECT_EQ(indices, (std::vector<std::uint32_t>{0, 1, 2, 3, 4, 5}));
+
+    EXPECT_EQ(remap[root.index()], 0);
+    EXPECT_EQ(remap[a.index()], 1);
+    EXPECT_EQ(remap[c.index()], 2);
+    EXPECT_EQ(remap[b.index()], 4);
+    EXPECT_EQ(remap[d.index()], 5);
+    EXPECT_EQ(Children(arena, arena.first_root()), "ab");
+}
+
+} // namespace
@@ -0,0 +1,164 @@
+#define STATIC_PTR_TRACE
+#include "static_ptr.h"
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+class IShape {
+public:
+    virtual ~IShape() = default;
+    virtual int Area() const = 0;
+};
+
+class TSquare : public IShape {
+public:
+    int Area() const override { return 4; }
+};
+
+class TRectangle : public IShape {
+public:
+    int Area() const override { return Width_ * Height_; }
+
+private:
+    int Width_ = 2;
+    int Height_ = 3;
+    char Padding_[16] = {};
+};
+
+using TOps = std::vector<std::pair<sp::trace_op, std::uint32_t>>;
+
+TOps Ops(const sp::op_trace& trace) {
+    TOps ops;
+    for (const auto& record : trace.records) {
+        ops.emplace_back(record.op, record.slot);
+    }
+    return ops;
+}
+
+class OpTrace : public ::testing::Test {
+protected:
+    void SetUp() override {
+        sp::clear_op_trace();
+    }
+
+    void TearDown() override {
+        sp::stop_op_trace();
+        sp::clear_op_trace();
+    }
+};
+
+TEST_F(OpTrace, Records) {
+    sp::static_ptr<IShape, 32> untraced;
+    untraced.emplace<TSquare>();
+
+    sp::start_op_trace();
+    {
+        sp::static_ptr<IShape, 32> a;
+        a.emplace<TSquare>();
+        EXPECT_EQ(a->Area(), 4);
+        a.emplace<TRectangle>();
+        EXPECT_EQ((*a).Area(), 6);
+
+        sp::static_ptr<IShape, 32> b = std::move(a);
+        // dereferences of empty pointers are not recorded
+        EXPECT_EQ(a.get(), nullptr);
+        EXPECT_EQ(b->Area(), 6);
+    }
+    EXPECT_EQ(untraced->Area(), 4);
+    sp::stop_op_trace();
+    untraced.reset();
+
+    const auto trace = sp::collect_op_trace();
+    using enum sp::trace_op;
+    EXPECT_EQ(Ops(trace), (TOps{
+        {emplace, 0},
+        {dispatch, 0},
+        {reset, 0},
+        {emplace, 0},
+        {dispatch, 0},
+        {move, 1},
+        {dispatch, 1},
+        {reset, 1},
+        {dispatch, 2},
+    }));
+    EXPECT_EQ(trace.slots, 3);
+    EXPECT_EQ(trace.records[5].source, 0);
+
+    ASSERT_EQ(trace.types.size(), 2);
+    EXPECT_EQ(trace.types[0].size, sizeof(TSquare));
+    EXPECT_EQ(trace.types[1].size, sizeof(TRectangle));
+    EXPECT_EQ(trace.types[trace.records[3].type].name, typeid(TRectangle).name());
+    EXPECT_EQ(sp::dropped_op_trace_records(), 0);
+}
+
+TEST_F(OpTrace, Serialization) {
+    sp::start_op_trace();
+    std::vector<sp::static_ptr<IShape>> shapes(10);
+    for (auto& shape : shapes) {
+        shape.emplace<TSquare>();
+    }
+    shapes[0] = std::move(shapes[9]);
+    sp::stop_op_trace();
+
+    const auto trace = sp::collect_op_trace();
+    std::stringstream stream;
+    trace.write(stream);
+    const auto read = sp::op_trace::read(stream);
+    EXPECT_EQ(read.slots, trace.slots);
+    ASSERT_EQ(read.types.size(), 1);
+    EXPECT_EQ(read.types[0].name, trace.types[0].name);
+    EXPECT_EQ(Ops(read), Ops(trace));
+    EXPECT_EQ(read.records.back().source, 9);
+
+    std::string bytes = stream.str();
+    std::stringstream truncated{bytes.substr(0, bytes.size() - 1)};
+    EXPECT_THROW(sp::op_trace::read(truncated), std::invalid_argument);
+    std::stringstream garbage{"garbage garbage garbage"};
+    EXPECT_THROW(sp::op_trace::read(garbage), std::invalid_argument);
+}
+
+TEST_F(OpTrace, ZeroedPadding) {
+    sp::op_trace trace;
+    trace.slots = 2;
+    sp::trace_record record;
+    std::memset(&record, 0xAB, sizeof(record));
+    record.slot = 1;
+    record.source = 0;
+    record.type = 0;
+    record.op = sp::trace_op::reset;
+    trace.records.push_back(record);
+
+    std::stringstream stream;
+    trace.write(stream);
+    const std::string bytes = stream.str();
+    // the header, the record count and a single record
+    ASSERT_EQ(bytes.size(), 3 * sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(sp::trace_record));
+    EXPECT_EQ(bytes.back(), 0);
+
+    const auto read = sp::op_trace::read(stream);
+    ASSERT_EQ(read.records.size(), 1);
+    EXPECT_EQ(read.records[0].slot, 1);
+    EXPECT_EQ(read.records[0].op, sp::trace_op::reset);
+}
+
+TEST_F(OpTrace, CorruptedOp) {
+    sp::op_trace trace;
+    trace.slots = 1;
+    trace.records.push_back({.slot = 0, .source = 0, .type = 0, .op = sp::trace_op::dispatch});
+
+    std::stringstream stream;
+    trace.write(stream);
+    std::string bytes = stream.str();
+    bytes[bytes.size() - sizeof(sp::trace_record) + offsetof(sp::trace_record, op)] = 4;
+    std::stringstream corrupted{bytes};
+    EXPECT_THROW(sp::op_trace::read(corrupted), std::invalid_argument);
+    EXPECT_EQ(sp::op_trace::read(stream).records.size(), 1);
+}
+
+} // namespace
@@ -0,0 +1,169 @@
+#include "packed_vector.h"
+#include <gtest/gtest.h>
+#include <map>
+#include <vector>
+
+namespace {
+
+class ISession {
+public:
+    ISession(int id) : Id_{id} {}
+    virtual ~ISession() = default;
+    virtual int Id() const { return Id_; }
+
+protected:
+    int Id_;
+};
+
+class TSecureSession : public ISession {
+public:
+    using ISession::ISession;
+    int Id() const override { return -Id_; }
+};
+
+std::vector<int> Ids(const sp::packed_vector<ISession>& sessions) {
+    std::vector<int> ids;
+    for (const auto& session : sessions) {
+        ids.push_back(session.Id());
+    }
+    return ids;
+}
+
+} // namespace
+
+TEST(PackedVector, EraseLeavesTombstones) {
+    sp::packed_vector<ISession> sessions;
+    for (int i = 0; i < 200; ++i) {
+        if (i % 2 == 0) {
+            EXPECT_EQ(sessions.emplace(i), i);
+        } else {
+            EXPECT_EQ(sessions.emplace<TSecureSession>(i), i);
+        }
+    }
+    EXPECT_EQ(sessions.size(), 200);
+
+    // erasing doesn't shift other objects
+    for (int i = 0; i < 200; ++i) {
+        if (i % 3 != 0 && i != 199) {
+            sessions.erase(i);
+        }
+    }
+    EXPECT_EQ(sessions.size(), 68);
+    EXPECT_EQ(sessions.slot_count(), 200);
+    EXPECT_EQ(sessions.tombstone_count(), 132);
+    EXPECT_TRUE(sessions.contains(0));
+    EXPECT_FALSE(sessions.contains(1));
+    EXPECT_EQ(sessions[3].Id(), -3);
+    EXPECT_EQ(sessions[199].Id(), -199);
+
+    std::vector<int> expected;
+    for (int i = 0; i < 200; ++i) {
+        if (i % 3 == 0 || i == 199) {
+            expected.push_back(i % 2 == 0 ? i : -i);
+        }
+    }
+    EXPECT_EQ(Ids(sessions), expected);
+}
+
+TEST(PackedVector, EmptyIteration) {
+    sp::packed_vector<ISession> sessions;
+    EXPECT_TRUE(sessions.begin() == sessions.end());
+    sessions.emplace(1);
+    sessions.erase(0);
+    EXPECT_TRUE(sessions.empty());
+    EXPECT_TRUE(sessions.begin() == sessions.end());
+}
+
+TEST(PackedVector, IncrementalCompaction) {
+    sp::packed_vector<ISession> sessions;
+    // external index from session id to slot
+    std::map<int, std::size_t> slot_of;
+    for (int i = 0; i < 100; ++i) {
+        slot_of[i] = sessions.emplace<TSecureSession>(i);
+    }
+    for (int i = 0; i < 100; i += 2) {
+        sessions.erase(slot_of[i]);
+        slot_of.erase(i);
+    }
+    const auto ids = Ids(sessions);
+
+    std::map<std::size_t, int> id_of;
+    for (auto [id, slot] : slot_of) {
+        id_of[slot] = id;
+    }
+    auto on_move = [&](std::size_t from, std::size_t to) {
+        const int id = id_of[from];
+        id_of.erase(from);
+        id_of[to] = id;
+        slot_of[id] = to;
+    };
+
+    // every step relocates a bounded number of objects
+    std::size_t steps = 0;
+    while (sessions.tombstone_count() > 0) {
+        EXPECT_LE(sessions.compact(8, on_move), 8);
+        EXPECT_EQ(Ids(sessions), ids);
+        ++steps;
+    }
+    EXPECT_EQ(steps, 7);
+    EXPECT_EQ(sessions.slot_count(), 50);
+    EXPECT_EQ(sessions.compact(8), 0);
+
+    for (auto [id, slot] : slot_of) {
+        EXPECT_EQ(sessions[slot].Id(), -id);
+    }
+}
+
+TEST(PackedVector, ChurnDuringCompaction) {
+    sp::packed_vector<ISession> sessions;
+    for (int i = 0; i < 10; ++i) {
+        sessions.emplace(i);
+    }
+    sessions.erase(0);
+    sessions.erase(5);
+    EXPECT_EQ(sessions.compact(2), 2);
+
+    // objects are appended and erased while the compaction is in progress,
+    // slot 1 is behind the compaction cursor and now holds the session 2
+    sessions.emplace(10);
+    sessions.erase(1);
+    while (sessions.compact(2) > 0) {
+    }
+    while (sessions.compact(2) > 0) {
+    }
+    EXPECT_EQ(sessions.tombstone_count(), 0);
+    EXPECT_EQ(Ids(sessions), (std::vector<int>{1, 3, 4, 6, 7, 8, 9, 10}));
+}
+
+TEST(PackedVector, Move) {
+    sp::packed_vector<ISession> sessions;
+    for (int i = 0; i < 100; ++i) {
+        sessions.emplace(i);
+    }
+    for (int i = 0; i < 50; ++i) {
+        sessions.erase(i * 2);
+    }
+    // a compaction pass is in progress
+    EXPECT_EQ(sessions.compact(10), 10);
+
+    sp::packed_vector<ISession> moved = std::move(sessions);
+    EXPECT_TRUE(sessions.empty());
+    EXPECT_EQ(sessions.slot_count(), 0);
+    EXPECT_EQ(sessions.tombstone_count(), 0);
+    EXPECT_EQ(sessions.compact(10), 0);
+    EXPECT_EQ(sessions.begin(), sessions.end());
+    EXPECT_EQ(moved.size(), 50);
+
+    // the compaction continues in the new owner
+    moved.compact(100);
+    EXPECT_EQ(moved.tombstone_count(), 0);
+    EXPECT_EQ(Ids(moved).size(), 50);
+
+    sessions.emplace(7);
+    sessions = std::move(moved);
+    EXPECT_EQ(sessions.size(), 50);
+    EXPECT_TRUE(moved.empty());
+    EXPECT_EQ(moved.tombstone_count(), 0);
+    EXPECT_EQ(moved.emplace(1), 0);
+    EXPECT_EQ(Ids(moved), std::vector<int>{1});
+}
@@ -0,0 +1,215 @@
+#include "pipeline.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using TStage = sp::pipeline_stage<int>;
+
+class TAddStage : public TStage {
+public:
+    TAddStage(int value) : Value_{value} {}
+
+    void process(std::span<const int> in, std::span<int> out) override {
+        for (std::size_t i = 0; i < in.size(); ++i) {
+            out[i] = in[i] + Value_;
+        }
+        ++Calls;
+    }
+
+    int Calls = 0;
+
+private:
+    int Value_;
+};
+
+class TMultiplyStage : public TStage {
+public:
+    TMultiplyStage(int value) : Value_{value} {}
+
+    void process(std::span<const int> in, std::span<int> out) override {
+        std::transform(in.begin(), in.end(), out.begin(), [this](int x) { return x * Value_; });
+    }
+
+private:
+    int Value_;
+};
+
+// fails on a negative value
+class TCheckStage : public TStage {
+public:
+    void process(std::span<const int> in, std::span<int> out) override {
+        for (std::size_t i = 0; i < in.size(); ++i) {
+            if (in[i] < 0) {
+                throw std::runtime_error("negative value");
+            }
+            out[i] = in[i];
+        }
+    }
+};
+
+// collects the output of the terminal stages
+struct TSink {
+    std::mutex Mutex;
+    std::vector<int> Values;
+    std::size_t Batches = 0;
+
+    void operator()(std::span<const int> batch) {
+        std::lock_guard guard{Mutex};
+        Values.insert(Values.end(), batch.begin(), batch.end());
+        ++Batches;
+    }
+};
+
+constexpr std::size_t StageSize = 32;
+
+} // namespace
+
+TEST(Pipeline, Chain) {
+    TSink sink;
+    sp::pipeline<int, StageSize> pipeline{{.threads = 4, .batch_size = 10, .queue_capacity = 2}, std::ref(sink)};
+    const auto add = pipeline.add_stage<TAddStage>(1);
+    const auto multiply = pipeline.add_stage<TMultiplyStage>(3);
+    const auto add_again = pipeline.add_stage<TAddStage>(-3);
+    pipeline.connect(add, multiply);
+    pipeline.connect(multiply, add_again);
+    pipeline.start();
+
+    for (int i = 0; i < 1005; ++i) {
+        pipeline.push(i);
+    }
+    pipeline.finish();
+
+    // the order is kept along a chain
+    std::vector<int> expected(1005);
+    std::iota(expected.begin(), expected.end(), 0);
+    std::transform(expected.begin(), expected.end(), expected.begin(), [](int x) { return 3 * x; });
+    EXPECT_EQ(sink.Values, expected);
+    // 100 full batches and an incomplete one
+    EXPECT_EQ(sink.Batches, 101);
+}
+
+TEST(Pipeline, Diamond) {
+    TSink sink;
+    sp::pipeline<int, StageSize> pipeline{{.threads = 3, .batch_size = 7}, std::ref(sink)};
+    const auto source = pipeline.add_stage<TAddStage>(0);
+    const auto left = pipeline.add_stage<TAddStage>(1);
+    const auto right = pipeline.add_stage<TMultiplyStage>(-1);
+    const auto join = pipeline.add_stage<TMultiplyStage>(2);
+    pipeline.connect(source, left);
+    pipeline.connect(source, right);
+    pipeline.connect(left, join);
+    pipeline.connect(right, join);
+    EXPECT_THROW(pipeline.connect(join, source), std::invalid_argument);
+    pipeline.start();
+
+    std::vector<int> input(100);
+    std::iota(input.begin(), input.end(), 0);
+    pipeline.push(input);
+    pipeline.finish();
+
+    // every element arrives through both branches
+    std::vector<int> expected;
+    for (int x : input) {
+        expected.push_back(2 * (x + 1));
+        expected.push_back(-2 * x);
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(sink.Values.begin(), sink.Values.end());
+    EXPECT_EQ(sink.Values, expected);
+}
+
+TEST(Pipeline, Restart) {
+    TSink sink;
+    sp::pipeline<int, StageSize> pipeline{{.threads = 2, .batch_size = 4}, std::ref(sink)};
+    pipeline.add_stage<TAddStage>(10);
+    pipeline.start();
+    pipeline.push(1);
+    pipeline.finish();
+    EXPECT_EQ(sink.Values, (std::vector<int>{11}));
+
+    pipeline.start();
+    pipeline.push(2);
+    pipeline.finish();
+    EXPECT_EQ(sink.Values, (std::vector<int>{11, 12}));
+}
+
+TEST(Pipeline, SerializedSink) {
+    // the sink has no lock of its own
+    std::atomic<int> inside = 0;
+    bool overlapped = false;
+    std::vector<int> values;
+    auto sink = [&](std::span<const int> batch) {
+        if (inside.fetch_add(1) != 0) {
+            overlapped = true;
+        }
+        values.insert(values.end(), batch.begin(), batch.end());
+        for (int i = 0; i < 100; ++i) {
+            std::this_thread::yield();
+        }
+        inside.fetch_sub(1);
+    };
+
+    sp::pipeline<int, StageSize> pipeline{{.threads = 4, .batch_size = 5}, sink};
+    const auto source = pipeline.add_stage<TAddStage>(0);
+    for (int i = 1; i <= 3; ++i) {
+        pipeline.connect(source, pipeline.add_stage<TAddStage>(1000 * i));
+    }
+    pipeline.start();
+    for (int i = 0; i < 500; ++i) {
+        pipeline.push(i);
+    }
+    pipeline.finish();
+
+    EXPECT_FALSE(overlapped);
+    EXPECT_EQ(values.size(), 1500);
+}
+
+TEST(Pipeline, ThrowingStage) {
+    TSink sink;
+    sp::pipeline<int, StageSize> pipeline{{.threads = 3, .batch_size = 4, .queue_capacity = 1}, std::ref(sink)};
+    const auto check = pipeline.add_stage<TCheckStage>();
+    pipeline.connect(check, pipeline.add_stage<TAddStage>(1));
+    pipeline.start();
+    for (int i = 0; i < 1000; ++i) {
+        pipeline.push(i == 500 ? -1 : i);
+    }
+    EXPECT_THROW(pipeline.finish(), std::runtime_error);
+    EXPECT_LT(sink.Values.size(), 1000);
+
+    // the failed pipeline can be restarted
+    sink.Values.clear();
+    pipeline.start();
+    pipeline.push(1);
+    pipeline.finish();
+    EXPECT_EQ(sink.Values, (std::vector<int>{2}));
+}
+
+TEST(Pipeline, ThrowingSink) {
+    auto sink = [](std::span<const int>) { throw std::runtime_error("sink"); };
+    sp::pipeline<int, StageSize> pipeline{{.threads = 2, .batch_size = 4}, sink};
+    pipeline.add_stage<TAddStage>(1);
+    pipeline.start();
+    for (int i = 0; i < 100; ++i) {
+        pipeline.push(i);
+    }
+    EXPECT_THROW(pipeline.finish(), std::runtime_error);
+}
+
+TEST(Pipeline, InvalidUse) {
+    EXPECT_THROW((sp::pipeline<int, StageSize>{{.threads = 0}}), std::invalid_argument);
+    EXPECT_THROW((sp::pipeline<int, StageSize>{{.batch_size = 0}}), std::invalid_argument);
+
+    TSink sink;
+    sp::pipeline<int, StageSize> pipeline{{}, std::ref(sink)};
+    pipeline.add_stage<TAddStage>(1);
+    EXPECT_THROW(pipeline.push(1), std::logic_error);
+    pipeline.finish();
+    EXPECT_TRUE(sink.Values.empty());
+}
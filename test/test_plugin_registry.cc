@@ -0,0 +1,145 @@
+#include "plugin_registry.h"
+#include "plugins/strategy.h"
+#include <dlfcn.h>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using TRegistry = sp::plugin_registry<IStrategy>;
+
+class TLocal : public IStrategy {
+public:
+    int Signal(int) const override { return 7; }
+};
+
+// whether the loader still has the shared object mapped
+bool Mapped(const char* path) {
+    void* handle = ::dlopen(path, RTLD_NOW | RTLD_NOLOAD);
+    if (handle) {
+        ::dlclose(handle);
+    }
+    return handle != nullptr;
+}
+
+TEST(PluginRegistry, Construct) {
+    auto& registry = TRegistry::instance();
+    EXPECT_EQ(registry.index_of(MomentumId), TRegistry::npos);
+    auto& momentum = registry.load(PLUGIN_MOMENTUM_PATH);
+    auto& arbitrage = registry.load(PLUGIN_ARBITRAGE_PATH);
+    EXPECT_TRUE(momentum.loaded());
+    EXPECT_EQ(momentum.path(), PLUGIN_MOMENTUM_PATH);
+
+    const auto trend = registry.index_of(TrendId);
+    ASSERT_NE(trend, TRegistry::npos);
+    ASSERT_NE(registry.index_of(MomentumId), TRegistry::npos);
+    ASSERT_NE(registry.index_of(ArbitrageId), TRegistry::npos);
+    EXPECT_EQ(registry.index_of(0x9999), TRegistry::npos);
+    EXPECT_EQ(registry.index_of(0), TRegistry::npos);
+
+    {
+        std::vector<sp::static_ptr<IStrategy, 32>> strategies;
+        for (int i = 0; i < 10; ++i) {
+            // the vector grows, moving the objects through the plugin's ops
+            ASSERT_TRUE(registry.emplace(registry.index_of(i % 2 ? MomentumId : TrendId), strategies.emplace_back()));
+        }
+        ASSERT_TRUE(registry.emplace(registry.index_of(ArbitrageId), strategies.emplace_back()));
+        strategies.emplace_back().emplace<TLocal>();
+        EXPECT_EQ(momentum.live_objects(), 10);
+        EXPECT_EQ(arbitrage.live_objects(), 1);
+
+        EXPECT_EQ(strategies[0]->Signal(5), 15);
+        EXPECT_EQ(strategies[1]->Signal(101), 1);
+        EXPECT_EQ(strategies[10]->Signal(3), 1);
+        EXPECT_EQ(registry.id_of(strategies[0]), TrendId);
+        EXPECT_EQ(registry.name_of(strategies[1]), "momentum");
+        EXPECT_EQ(registry.id_of(strategies[11]), 0);
+        EXPECT_EQ(registry.name_of(strategies[11]), "");
+
+        sp::static_ptr<IStrategy, 32> copy;
+        sp::_::clone(copy, strategies[0]);
+        EXPECT_EQ(copy->Signal(1), 3);
+        EXPECT_EQ(momentum.live_objects(), 11);
+        strategies[2] = std::move(strategies[0]);
+        EXPECT_EQ(momentum.live_objects(), 10);
+        strategies[3].reset();
+        EXPECT_EQ(momentum.live_objects(), 9);
+    }
+    EXPECT_EQ(momentum.live_objects(), 0);
+    EXPECT_EQ(arbitrage.live_objects(), 0);
+
+    registry.unload(momentum);
+    registry.unload(arbitrage);
+    EXPECT_FALSE(momentum.loaded());
+    EXPECT_FALSE(Mapped(PLUGIN_MOMENTUM_PATH));
+    EXPECT_FALSE(Mapped(PLUGIN_ARBITRAGE_PATH));
+}
+
+TEST(PluginRegistry, DeferredUnload) {
+    auto& registry = TRegistry::instance();
+    auto& momentum = registry.load(PLUGIN_MOMENTUM_PATH);
+    const auto index = registry.index_of(MomentumId);
+    sp::static_ptr<IStrategy> strategy;
+    ASSERT_TRUE(registry.emplace(index, strategy));
+
+    // the type is gone, but the plugin stays open while its object is alive
+    registry.unload(momentum);
+    EXPECT_EQ(registry.index_of(MomentumId), TRegistry::npos);
+    sp::static_ptr<IStrategy> other;
+    EXPECT_FALSE(registry.emplace(index, other));
+    EXPECT_FALSE(other);
+    EXPECT_TRUE(momentum.loaded());
+    EXPECT_TRUE(Mapped(PLUGIN_MOMENTUM_PATH));
+    EXPECT_EQ(registry.collect(), 0);
+
+    sp::static_ptr<IStrategy> moved = std::move(strategy);
+    EXPECT_EQ(moved->Signal(99), -1);
+    EXPECT_EQ(momentum.live_objects(), 1);
+
+    // an ID can't be taken while the old plugin is open
+    EXPECT_THROW(registry.load(PLUGIN_MOMENTUM_PATH), std::invalid_argument);
+
+    moved.reset();
+    EXPECT_EQ(registry.collect(), 1);
+    EXPECT_FALSE(momentum.loaded());
+    EXPECT_FALSE(Mapped(PLUGIN_MOMENTUM_PATH));
+
+    // the type gets its index back once the plugin is loaded again
+    auto& reloaded = registry.load(PLUGIN_MOMENTUM_PATH);
+    EXPECT_EQ(registry.index_of(MomentumId), index);
+    ASSERT_TRUE(registry.emplace(index, strategy));
+    EXPECT_EQ(strategy->Signal(101), 1);
+    strategy.reset();
+    registry.unload(reloaded);
+    EXPECT_FALSE(reloaded.loaded());
+}
+
+TEST(PluginRegistry, Errors) {
+    auto& registry = TRegistry::instance();
+    EXPECT_THROW(registry.load("./no_such_plugin.so"), std::invalid_argument);
+
+    auto& arbitrage = registry.load(PLUGIN_ARBITRAGE_PATH);
+    const auto index = registry.index_of(ArbitrageId);
+    // the same ID from a second copy is rejected, the first one stays
+    EXPECT_THROW(registry.load(PLUGIN_ARBITRAGE_PATH), std::invalid_argument);
+    EXPECT_EQ(registry.index_of(ArbitrageId), index);
+
+    sp::static_ptr<IStrategy, 0> strategy;
+    ASSERT_TRUE(registry.emplace(index, strategy));
+    EXPECT_EQ(strategy->Signal(2), 0);
+    EXPECT_FALSE(registry.emplace(TRegistry::npos, strategy));
+
+    auto& momentum = registry.load(PLUGIN_MOMENTUM_PATH);
+    sp::static_ptr<IStrategy, 16> small;
+    EXPECT_THROW(registry.emplace(registry.index_of(TrendId), small), std::length_error);
+    EXPECT_EQ(momentum.live_objects(), 0);
+    registry.unload(momentum);
+
+    strategy.reset();
+    registry.unload(arbitrage);
+    EXPECT_FALSE(Mapped(PLUGIN_ARBITRAGE_PATH));
+}
+
+} // namespace
@@ -0,0 +1,214 @@
+#include "poly_deque.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct TCounters {
+    int Constructions = 0;
+    int Destructions = 0;
+    int Moves = 0;
+};
+
+class IValue {
+public:
+    virtual ~IValue() = default;
+    virtual int Get() const = 0;
+};
+
+class TValue : public IValue {
+public:
+    TValue(TCounters& counters, int value) : Counters_{counters}, Value_{value} {
+        ++Counters_.Constructions;
+    }
+    TValue(TValue&& rhs) : Counters_{rhs.Counters_}, Value_{rhs.Value_} {
+        ++Counters_.Moves;
+    }
+    TValue& operator=(TValue&& rhs) {
+        Value_ = rhs.Value_;
+        ++Counters_.Moves;
+        return *this;
+    }
+    ~TValue() {
+        ++Counters_.Destructions;
+    }
+
+    int Get() const override { return Value_; }
+
+private:
+    TCounters& Counters_;
+    int Value_;
+};
+
+class TNegated : public IValue {
+public:
+    TNegated(int value) : Value_{value} {}
+    int Get() const override { return -Value_; }
+
+private:
+    int Value_;
+};
+
+using TDeque = sp::poly_deque<IValue, 32, 4>;
+
+std::vector<int> Values(const TDeque& deque) {
+    std::vector<int> values;
+    for (const auto& value : deque) {
+        values.push_back(value.Get());
+    }
+    return values;
+}
+
+TEST(PolyDeque, BothEnds) {
+    TCounters counters;
+    {
+        TDeque deque;
+        EXPECT_TRUE(deque.empty());
+        for (int i = 0; i < 10; ++i) {
+            deque.emplace_back<TValue>(counters, i);
+            deque.emplace_front<TNegated>(i + 1);
+        }
+        EXPECT_EQ(deque.size(), 20);
+        EXPECT_EQ(deque.front().Get(), -10);
+        EXPECT_EQ(deque.back().Get(), 9);
+        EXPECT_EQ(deque[10].Get(), 0);
+
+        deque.pop_front();
+        deque.pop_back();
+        EXPECT_EQ(Values(deque), (std::vector<int>{-9, -8, -7, -6, -5, -4, -3, -2, -1, 0, 1, 2, 3, 4, 5, 6, 7, 8}));
+        EXPECT_EQ(counters.Destructions, 1);
+    }
+    EXPECT_EQ(counters.Constructions, 10);
+    EXPECT_EQ(counters.Destructions, 10);
+    // the objects are never moved
+    EXPECT_EQ(counters.Moves, 0);
+}
+
+TEST(PolyDeque, StableAddresses) {
+    TCounters counters;
+    TDeque deque;
+    std::vector<const IValue*> addresses;
+    for (int i = 0; i < 100; ++i) {
+        addresses.push_back(&deque.emplace_back<TValue>(counters, i));
+    }
+    for (int i = 0; i < 100; ++i) {
+        deque.emplace_front<TNegated>(i);
+        deque.emplace_back<TNegated>(i);
+    }
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(addresses[i]->Get(), i);
+        EXPECT_EQ(&deque[100 + i], addresses[i]);
+    }
+}
+
+TEST(PolyDeque, Random) {
+    TDeque deque;
+    std::deque<int> expected;
+    std::mt19937 rng{42};
+    for (int i = 0; i < 10000; ++i) {
+        switch (rng() % 4) {
+        case 0:
+            deque.emplace_back<TNegated>(-i);
+            expected.push_back(i);
+            break;
+        case 1:
+            deque.emplace_front<TNegated>(-i);
+            expected.push_front(i);
+            break;
+        case 2:
+            if (!expected.empty()) {
+                deque.pop_back();
+                expected.pop_back();
+            }
+            break;
+        case 3:
+            if (!expected.empty()) {
+                deque.pop_front();
+                expected.pop_front();
+            }
+            break;
+        }
+        ASSERT_EQ(deque.size(), expected.size());
+    }
+    EXPECT_EQ(Values(deque), std::vector<int>(expected.begin(), expected.end()));
+
+    std::vector<int> values;
+    deque.for_each([&](const IValue& value) { values.push_back(value.Get()); });
+    EXPECT_EQ(values, std::vector<int>(expected.begin(), expected.end()));
+
+    deque.clear();
+    EXPECT_TRUE(deque.empty());
+    EXPECT_EQ(deque.begin(), deque.end());
+}
+
+TEST(PolyDeque, Iterators) {
+    TDeque deque;
+    for (int i = 0; i < 10; ++i) {
+        deque.emplace_back<TNegated>(i);
+    }
+    auto it = deque.end();
+    --it;
+    EXPECT_EQ(it->Get(), -9);
+    TDeque::const_iterator cit = it;
+    EXPECT_EQ((*cit).Get(), -9);
+    EXPECT_EQ(std::count_if(deque.begin(), deque.end(), [](const IValue& v) { return v.Get() % 2 == 0; }), 5);
+}
+
+} // namespace
+
+TEST(PolyDeque, Move) {
+    TCounters counters;
+    {
+        TDeque deque;
+        for (int i = 0; i < 10; ++i) {
+            deque.emplace_back<TValue>(counters, i);
+        }
+        deque.pop_front();
+
+        TDeque moved = std::move(deque);
+        EXPECT_TRUE(deque.empty());
+        EXPECT_EQ(deque.begin(), deque.end());
+        EXPECT_EQ(moved.size(), 9);
+        EXPECT_EQ(moved.front().Get(), 1);
+        EXPECT_EQ(counters.Moves, 0);
+
+        // the moved-from deque is usable
+        deque.emplace_front<TNegated>(1);
+        deque.emplace_back<TNegated>(2);
+        EXPECT_EQ(Values(deque), (std::vector<int>{-1, -2}));
+
+        deque = std::move(moved);
+        EXPECT_EQ(deque.size(), 9);
+        EXPECT_TRUE(moved.empty());
+        EXPECT_EQ(moved.begin(), moved.end());
+    }
+    EXPECT_EQ(counters.Constructions, counters.Destructions);
+}
+
+// a deque used as a queue in either direction keeps a bounded directory
+TEST(PolyDeque, Queue) {
+    TCounters counters;
+    TDeque deque;
+    for (int i = 0; i < 10; ++i) {
+        deque.emplace_back<TValue>(counters, i);
+    }
+    for (int i = 10; i < 100000; ++i) {
+        deque.emplace_back<TValue>(counters, i);
+        deque.pop_front();
+        ASSERT_EQ(deque.front().Get(), i - 9);
+        ASSERT_LE(deque.directory_size(), 8);
+    }
+    EXPECT_EQ(deque.size(), 10);
+
+    for (int i = 0; i < 100000; ++i) {
+        deque.emplace_front<TNegated>(i);
+        deque.pop_back();
+        ASSERT_LE(deque.directory_size(), 8);
+    }
+    EXPECT_EQ(deque.front().Get(), -99999);
+    EXPECT_EQ(deque.back().Get(), -99990);
+    EXPECT_EQ(counters.Moves, 0);
+}
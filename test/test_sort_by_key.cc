@@ -0,0 +1,165 @@
+#include "sort_by_key.h"
+#include "huge_vector.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+class IItem {
+public:
+    virtual ~IItem() = default;
+    virtual std::int64_t Key() const = 0;
+    virtual int Id() const = 0;
+};
+
+// counts the moves and the key extractions
+struct TCounters {
+    int Moves = 0;
+    int Keys = 0;
+};
+
+class TItem : public IItem {
+public:
+    TItem(TCounters& counters, std::int64_t key, int id) : Counters_{&counters}, Key_{key}, Id_{id} {}
+    TItem(TItem&& rhs) : Counters_{rhs.Counters_}, Key_{rhs.Key_}, Id_{rhs.Id_} {
+        ++Counters_->Moves;
+    }
+    TItem& operator=(TItem&& rhs) {
+        Counters_ = rhs.Counters_;
+        Key_ = rhs.Key_;
+        Id_ = rhs.Id_;
+        ++Counters_->Moves;
+        return *this;
+    }
+
+    std::int64_t Key() const override {
+        ++Counters_->Keys;
+        return Key_;
+    }
+    int Id() const override { return Id_; }
+
+private:
+    TCounters* Counters_;
+    std::int64_t Key_;
+    int Id_;
+};
+
+class TOtherItem : public IItem {
+public:
+    TOtherItem(std::int64_t key, int id) : Key_{key}, Id_{id} {}
+    std::int64_t Key() const override { return Key_; }
+    int Id() const override { return Id_; }
+
+private:
+    std::int64_t Key_;
+    int Id_;
+    char Padding_[8] = {};
+};
+
+class IRank {
+public:
+    virtual ~IRank() = default;
+    virtual std::uint32_t Rank() const = 0;
+};
+
+class TRank : public IRank {
+public:
+    TRank(std::uint32_t rank) : Rank_{rank} {}
+    std::uint32_t Rank() const override { return Rank_; }
+
+private:
+    std::uint32_t Rank_;
+};
+
+} // namespace
+
+STATIC_PTR_TRIVIALLY_RELOCATABLE(IRank)
+
+namespace {
+
+using TItems = std::vector<sp::static_ptr<IItem, 32>>;
+
+std::vector<int> Ids(const TItems& items) {
+    std::vector<int> ids;
+    for (const auto& item : items) {
+        ids.push_back(item ? item->Id() : -1);
+    }
+    return ids;
+}
+
+TEST(SortByKey, IntegralKeys) {
+    TCounters counters;
+    TItems items;
+    std::mt19937 rng{42};
+    std::vector<std::pair<std::int64_t, int>> expected;
+    for (int i = 0; i < 1000; ++i) {
+        // negative keys and duplicates
+        const std::int64_t key = static_cast<std::int64_t>(rng() % 100) - 50;
+        if (i % 2) {
+            items.emplace_back().emplace<TItem>(counters, key, i);
+        } else {
+            items.emplace_back().emplace<TOtherItem>(key, i);
+        }
+        expected.emplace_back(key, i);
+    }
+    std::stable_sort(expected.begin(), expected.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    counters = {};
+    sp::sort_by_key(items, [](const IItem& item) { return item.Key(); });
+
+    std::vector<int> ids;
+    for (const auto& [key, id] : expected) {
+        ids.push_back(id);
+    }
+    EXPECT_EQ(Ids(items), ids);
+    // a single key extraction per object, one move per object plus one per cycle
+    EXPECT_EQ(counters.Keys, 500);
+    EXPECT_LE(counters.Moves, 1000);
+}
+
+TEST(SortByKey, OtherKeys) {
+    TItems items;
+    const std::vector<std::string> names = {"pear", "apple", "fig", "apple", "kiwi"};
+    for (int i = 0; i < 5; ++i) {
+        items.emplace_back().emplace<TOtherItem>(0, i);
+    }
+    sp::sort_by_key(items, [&](const IItem& item) { return names[item.Id()]; });
+    EXPECT_EQ(Ids(items), (std::vector<int>{1, 3, 2, 4, 0}));
+
+    sp::sort_by_key(items, [](const IItem& item) { return -0.5 * item.Id(); });
+    EXPECT_EQ(Ids(items), (std::vector<int>{4, 3, 2, 1, 0}));
+}
+
+TEST(SortByKey, EmptyPointers) {
+    TItems items;
+    items.emplace_back().emplace<TOtherItem>(3, 0);
+    items.emplace_back();
+    items.emplace_back().emplace<TOtherItem>(1, 2);
+    items.emplace_back();
+    items.emplace_back().emplace<TOtherItem>(2, 4);
+    sp::sort_by_key(items, [](const IItem& item) { return static_cast<std::uint8_t>(item.Key()); });
+    EXPECT_EQ(Ids(items), (std::vector<int>{2, 4, 0, -1, -1}));
+
+    TItems none;
+    sp::sort_by_key(none, [](const IItem& item) { return item.Key(); });
+    EXPECT_TRUE(none.empty());
+}
+
+TEST(SortByKey, HugeVector) {
+    sp::huge_vector<sp::static_ptr<IRank>> items;
+    for (int i = 0; i < 100; ++i) {
+        items.emplace_back().emplace<TRank>(100 - i);
+    }
+    sp::sort_by_key(items, [](const IRank& item) { return item.Rank(); });
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(items[i]->Rank(), i + 1);
+    }
+}
+
+} // namespace
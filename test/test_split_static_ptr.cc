@@ -0,0 +1,180 @@
+#include "split_static_ptr.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+using EventsType = std::vector<std::string>;
+
+class IInstrument {
+public:
+    virtual ~IInstrument() = default;
+    virtual double Price() const = 0;
+};
+
+// small instrument without a cold part
+class TStock : public IInstrument {
+public:
+    TStock(double price) : Price_{price} {}
+    double Price() const override { return Price_; }
+
+private:
+    double Price_;
+};
+
+// instrument with a large rarely used part
+struct TOptionDetails {
+    TOptionDetails() = default;
+    ~TOptionDetails() {
+        if (Events) {
+            Events->push_back("TOptionDetails::~TOptionDetails()");
+        }
+    }
+
+    EventsType* Events = nullptr;
+    char Description[1024] = {};
+};
+
+class TOption : public IInstrument {
+public:
+    using cold_type = TOptionDetails;
+
+    TOption(TOptionDetails& details, EventsType& events, double premium)
+        : Details_{&details}
+        , Events_{events}
+        , Premium_{premium}
+    {
+        Details_->Events = &events;
+        Events_.push_back("TOption::TOption()");
+    }
+
+    TOption(TOption&& option) = default;
+
+    ~TOption() {
+        Events_.push_back("TOption::~TOption()");
+    }
+
+    double Price() const override { return Premium_; }
+    const TOptionDetails& Details() const { return *Details_; }
+
+private:
+    TOptionDetails* Details_;
+    EventsType& Events_;
+    double Premium_;
+};
+
+constexpr std::size_t HotSize = 32;
+
+} // namespace
+
+TEST(SplitStaticPtr, HotPartIsSmall) {
+    EXPECT_LE(sizeof(TOption), HotSize);
+    EXPECT_GT(sizeof(TOption) + sizeof(TOptionDetails), HotSize);
+    EXPECT_LE(sizeof(sp::static_ptr<IInstrument, HotSize>), HotSize + alignof(std::max_align_t));
+}
+
+TEST(SplitStaticPtr, ColdPartLifetime) {
+    EventsType events;
+    {
+        sp::split_static_ptr<IInstrument, HotSize> instrument;
+        EXPECT_FALSE(instrument);
+
+        auto& option = instrument.emplace<TOption>(events, 2.5);
+        EXPECT_TRUE(instrument);
+        EXPECT_EQ(instrument->Price(), 2.5);
+        EXPECT_EQ(&option.Details(), &instrument.cold<TOption>());
+
+        // moving the hot part keeps the cold part in place
+        const auto* details = &instrument.cold<TOption>();
+        auto moved = std::move(instrument);
+        EXPECT_EQ(&moved.cold<TOption>(), details);
+
+        moved.emplace<TStock>(10.0);
+        EXPECT_EQ(moved->Price(), 10.0);
+    }
+
+    const EventsType expected{
+        "TOption::TOption()",
+        // the moved-from temporary object
+        "TOption::~TOption()",
+        // hot part is destructed first
+        "TOption::~TOption()",
+        "TOptionDetails::~TOptionDetails()",
+    };
+    EXPECT_EQ(events, expected);
+}
+
+TEST(SplitStaticPtr, Vector) {
+    EventsType events;
+    {
+        sp::split_vector<IInstrument, HotSize, sizeof(TOptionDetails)> instruments;
+        for (int i = 0; i < 100; ++i) {
+            if (i % 2 == 0) {
+                instruments.emplace_back<TStock>(i);
+            } else {
+                auto& option = instruments.emplace_back<TOption>(events, i);
+                snprintf(instruments.cold<TOption>(i).Description, 1024, "option %d", i);
+                EXPECT_EQ(&option.Details(), &instruments.cold<TOption>(i));
+            }
+        }
+        EXPECT_EQ(instruments.size(), 100);
+
+        // iteration touches only the hot parts
+        double total = 0;
+        for (const auto& instrument : instruments) {
+            total += instrument->Price();
+        }
+        EXPECT_EQ(total, 4950);
+
+        // cold parts survive relocation of the hot parts
+        const auto& option = static_cast<const TOption&>(instruments[51]);
+        EXPECT_STREQ(option.Details().Description, "option 51");
+        EXPECT_STREQ(instruments.cold<TOption>(99).Description, "option 99");
+
+        // the cold parts are laid out by the slot, not allocated one by one
+        const auto* first = reinterpret_cast<const char*>(&instruments.cold<TOption>(1));
+        const auto* third = reinterpret_cast<const char*>(&instruments.cold<TOption>(3));
+        EXPECT_EQ(third - first, 2 * sp::_::cold_pool<sizeof(TOptionDetails)>::stride);
+
+        events.clear();
+        instruments.pop_back();
+        const EventsType expected{
+            "TOption::~TOption()",
+            "TOptionDetails::~TOptionDetails()",
+        };
+        EXPECT_EQ(events, expected);
+    }
+}
+
+TEST(SplitStaticPtr, VectorReuse) {
+    EventsType events;
+    {
+        sp::split_vector<IInstrument, HotSize, sizeof(TOptionDetails)> instruments;
+        instruments.reserve(10);
+        for (int i = 0; i < 200; ++i) {
+            instruments.emplace_back<TOption>(events, i);
+        }
+        instruments.clear();
+        EXPECT_EQ(std::count(events.begin(), events.end(), "TOptionDetails::~TOptionDetails()"), 200);
+
+        // a slot freed by pop_back gets a new cold part
+        instruments.emplace_back<TStock>(1.0);
+        auto& option = instruments.emplace_back<TOption>(events, 2.0);
+        EXPECT_EQ(&option.Details(), &instruments.cold<TOption>(1));
+        instruments.pop_back();
+        instruments.emplace_back<TOption>(events, 3.0);
+        EXPECT_EQ(instruments[1].Price(), 3.0);
+
+        auto moved = std::move(instruments);
+        EXPECT_TRUE(instruments.empty());
+        EXPECT_EQ(moved.size(), 2);
+        events.clear();
+    }
+    const EventsType expected{
+        "TOption::~TOption()",
+        "TOptionDetails::~TOptionDetails()",
+    };
+    EXPECT_EQ(events, expected);
+}
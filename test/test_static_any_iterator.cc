@@ -0,0 +1,138 @@
+#include "static_any_iterator.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <forward_list>
+#include <list>
+#include <map>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using IntRange = sp::static_any_range<const int&>;
+using BidirectionalIntRange = sp::static_any_range<const int&, std::bidirectional_iterator_tag>;
+
+// the interface doesn't depend on the underlying container
+int Sum(IntRange range) {
+    int sum = 0;
+    for (int value : range) {
+        sum += value;
+    }
+    return sum;
+}
+
+// iterator which holds a big state
+struct TBigIterator {
+    using value_type = int;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    int Pos = 0;
+    char Padding[128];
+
+    const int& operator*() const { return Pos; }
+    TBigIterator& operator++() { ++Pos; return *this; }
+    TBigIterator operator++(int) { auto tmp = *this; ++Pos; return tmp; }
+    bool operator==(const TBigIterator& rhs) const { return Pos == rhs.Pos; }
+};
+
+} // namespace
+
+TEST(StaticAnyIterator, DifferentContainers) {
+    const std::vector<int> vector{1, 2, 3, 4};
+    const std::list<int> list{10, 20, 30};
+    EXPECT_EQ(Sum(vector), 10);
+    EXPECT_EQ(Sum(list), 60);
+    EXPECT_EQ(Sum({}), 0);
+}
+
+TEST(StaticAnyIterator, ForwardOnly) {
+    std::forward_list<int> list{1, 2, 3};
+    EXPECT_EQ(Sum(list), 6);
+
+    sp::static_any_iterator<int&> it = list.begin();
+    *it = 5;
+    ++it;
+    EXPECT_EQ(*it, 2);
+    EXPECT_EQ(list.front(), 5);
+}
+
+TEST(StaticAnyIterator, IteratorConcepts) {
+    using Iterator = IntRange::iterator;
+    using BidirectionalIterator = BidirectionalIntRange::iterator;
+    EXPECT_TRUE(std::forward_iterator<Iterator>);
+    EXPECT_FALSE(std::bidirectional_iterator<Iterator>);
+    EXPECT_TRUE(std::bidirectional_iterator<BidirectionalIterator>);
+
+    // forward iterators are not bidirectional
+    EXPECT_TRUE((std::is_constructible_v<Iterator, std::vector<int>::const_iterator>));
+    EXPECT_FALSE((std::is_constructible_v<BidirectionalIterator, std::forward_list<int>::const_iterator>));
+    // big iterators don't fit into the buffer
+    EXPECT_FALSE((std::is_constructible_v<Iterator, TBigIterator>));
+    EXPECT_TRUE((std::is_constructible_v<sp::static_any_iterator<const int&, std::forward_iterator_tag, sizeof(TBigIterator)>, TBigIterator>));
+
+    // references can't be bound to the values of a view
+    auto doubled = std::views::iota(0, 3) | std::views::transform([](int x) { return 2 * x; });
+    using TransformIterator = std::ranges::iterator_t<decltype(doubled)>;
+    EXPECT_FALSE((std::is_constructible_v<Iterator, TransformIterator>));
+    EXPECT_TRUE((std::is_constructible_v<sp::static_any_iterator<int, std::input_iterator_tag>, TransformIterator>));
+}
+
+TEST(StaticAnyIterator, MismatchedRange) {
+    const std::vector<int> vector{1, 2, 3};
+    const std::list<int> list{1, 2, 3};
+    EXPECT_THROW(IntRange(vector.begin(), list.end()), std::invalid_argument);
+    EXPECT_THROW(IntRange(vector.begin(), IntRange::iterator{}), std::invalid_argument);
+    EXPECT_EQ(Sum(IntRange(list.begin(), list.end())), 6);
+}
+
+TEST(StaticAnyIterator, Bidirectional) {
+    const std::list<int> list{1, 2, 3};
+    BidirectionalIntRange range{list};
+    std::vector<int> reversed;
+    std::reverse_copy(range.begin(), range.end(), std::back_inserter(reversed));
+    EXPECT_EQ(reversed, (std::vector<int>{3, 2, 1}));
+}
+
+TEST(StaticAnyIterator, CopyAndCompare) {
+    const std::vector<int> vector{1, 2, 3};
+    const std::list<int> list{1, 2, 3};
+    IntRange::iterator it = vector.begin();
+    auto copy = it;
+    EXPECT_TRUE(it == copy);
+    ++copy;
+    EXPECT_FALSE(it == copy);
+    EXPECT_EQ(*copy, 2);
+    EXPECT_EQ(*it++, 1);
+    EXPECT_TRUE(it == copy);
+
+    // iterators of different types are never equal
+    IntRange::iterator other = list.begin();
+    EXPECT_FALSE(it == other);
+    EXPECT_TRUE(IntRange::iterator{} == IntRange::iterator{});
+}
+
+TEST(StaticAnyIterator, MutableValues) {
+    std::map<std::string, int> map{{"a", 1}, {"b", 2}};
+    sp::static_any_range<std::pair<const std::string, int>&> range{map};
+    for (auto& [key, value] : range) {
+        value *= 10;
+    }
+    EXPECT_EQ(map["a"], 10);
+    EXPECT_EQ(map["b"], 20);
+}
+
+TEST(StaticAnyIterator, ForEach) {
+    const std::vector<int> vector{1, 2, 3, 4};
+    IntRange range{vector};
+    int sum = 0;
+    range.for_each([&sum](int value) { sum += value; });
+    EXPECT_EQ(sum, 10);
+
+    IntRange empty;
+    EXPECT_TRUE(empty.empty());
+    empty.for_each([&sum](int value) { sum += value; });
+    EXPECT_EQ(sum, 10);
+}
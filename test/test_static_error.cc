@@ -0,0 +1,182 @@
+#include "static_error.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <variant>
+
+namespace {
+
+struct TCounters {
+    int Moves = 0;
+    int Destructions = 0;
+};
+
+struct TRejected {
+    std::uint64_t OrderId;
+    int Reason;
+
+    std::string message() const {
+        return "order " + std::to_string(OrderId) + " rejected: " + std::to_string(Reason);
+    }
+};
+
+struct TTimeout {
+    const char* message() const { return "timeout"; }
+};
+
+// not trivially relocatable, counts its moves
+class TTracked {
+public:
+    TTracked(TCounters& counters) : Counters_{&counters} {}
+    TTracked(TTracked&& rhs) noexcept : Counters_{rhs.Counters_} {
+        ++Counters_->Moves;
+    }
+    TTracked& operator=(TTracked&& rhs) noexcept {
+        Counters_ = rhs.Counters_;
+        ++Counters_->Moves;
+        return *this;
+    }
+    ~TTracked() {
+        ++Counters_->Destructions;
+    }
+
+    TCounters* Counters() const { return Counters_; }
+
+private:
+    TCounters* Counters_;
+};
+
+// a detail without `message()`
+enum class EErrorCode {
+    NotFound,
+    Busy,
+};
+
+struct TThrowingMove {
+    TThrowingMove() = default;
+    TThrowingMove(TThrowingMove&&) {}
+    std::string message() const { return {}; }
+};
+
+struct TBig {
+    char Data[64];
+    std::string message() const { return {}; }
+};
+
+template<typename T, std::size_t Size>
+concept CanHold = requires(sp::static_error<Size> error) {
+    error.template emplace<T>();
+};
+
+} // namespace
+
+namespace sp {
+
+template<>
+struct error_traits<TTracked> {
+    static void render(const TTracked&, std::string& out) {
+        out += "tracked";
+    }
+};
+
+template<>
+struct error_traits<EErrorCode> {
+    static void render(EErrorCode code, std::string& out) {
+        out += code == EErrorCode::NotFound ? "not found" : "busy";
+    }
+};
+
+} // namespace sp
+
+namespace {
+
+TEST(StaticError, HoldsAndMessage) {
+    sp::static_error<> error;
+    EXPECT_FALSE(error);
+    EXPECT_FALSE(error.holds<TRejected>());
+    EXPECT_EQ(error.message(), "");
+
+    error.emplace<TRejected>(42u, 7);
+    EXPECT_TRUE(error);
+    EXPECT_TRUE(error.holds<TRejected>());
+    EXPECT_FALSE(error.holds<TTimeout>());
+    ASSERT_NE(error.get_if<TRejected>(), nullptr);
+    EXPECT_EQ(error.get_if<TRejected>()->OrderId, 42u);
+    EXPECT_EQ(error.get_if<TTimeout>(), nullptr);
+    EXPECT_EQ(error.message(), "order 42 rejected: 7");
+
+    error.emplace<EErrorCode>(EErrorCode::Busy);
+    EXPECT_TRUE(error.holds<EErrorCode>());
+    std::string out = "error: ";
+    error.render(out);
+    EXPECT_EQ(out, "error: busy");
+
+    error = sp::make_error<TTimeout>();
+    EXPECT_EQ(error.message(), "timeout");
+    error.reset();
+    EXPECT_FALSE(error);
+}
+
+TEST(StaticError, Moves) {
+    TCounters counters;
+    {
+        sp::static_error<16> small;
+        small.emplace<TTracked>(counters);
+
+        sp::static_error<64> large = std::move(small);
+        EXPECT_FALSE(small);
+        EXPECT_TRUE(large.holds<TTracked>());
+        EXPECT_EQ(large.get_if<TTracked>()->Counters(), &counters);
+        EXPECT_EQ(large.message(), "tracked");
+        EXPECT_EQ(counters.Moves, 1);
+        EXPECT_EQ(counters.Destructions, 1);
+
+        // same type, move assigned
+        small.emplace<TTracked>(counters);
+        large = std::move(small);
+        EXPECT_EQ(counters.Moves, 2);
+        EXPECT_EQ(counters.Destructions, 2);
+
+        // different type, the old detail is destructed
+        large = sp::make_error<TRejected>(1u, 2);
+        EXPECT_EQ(counters.Destructions, 3);
+        EXPECT_EQ(large.message(), "order 1 rejected: 2");
+
+        large.emplace<TTracked>(counters);
+    }
+    EXPECT_EQ(counters.Moves, 2);
+    EXPECT_EQ(counters.Destructions, 4);
+}
+
+TEST(StaticError, Constraints) {
+    EXPECT_TRUE((CanHold<TTimeout, 16>));
+    EXPECT_TRUE((CanHold<TBig, 64>));
+    EXPECT_FALSE((CanHold<TBig, 32>));
+    // the moves of errors must not throw
+    EXPECT_FALSE((CanHold<TThrowingMove, 32>));
+
+    EXPECT_TRUE((std::is_constructible_v<sp::static_error<64>, sp::static_error<32>&&>));
+    EXPECT_FALSE((std::is_constructible_v<sp::static_error<32>, sp::static_error<64>&&>));
+    EXPECT_TRUE(std::is_nothrow_move_constructible_v<sp::static_error<>>);
+}
+
+// expected-style returns
+std::variant<int, sp::static_error<>> Parse(int value) {
+    if (value < 0) {
+        return sp::make_error<TRejected>(static_cast<std::uint64_t>(-value), 1);
+    }
+    return value * 2;
+}
+
+TEST(StaticError, Result) {
+    auto ok = Parse(21);
+    ASSERT_EQ(ok.index(), 0);
+    EXPECT_EQ(std::get<0>(ok), 42);
+
+    auto failed = Parse(-5);
+    ASSERT_EQ(failed.index(), 1);
+    EXPECT_EQ(std::get<1>(failed).message(), "order 5 rejected: 1");
+}
+
+} // namespace
@@ -0,0 +1,147 @@
+#include "static_shared.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using EventsType = std::vector<std::string>;
+
+class IEngine {
+public:
+    IEngine(EventsType& events) : Events_{events} {}
+    virtual ~IEngine() = default;
+    virtual void Do() = 0;
+
+protected:
+    EventsType& Events_;
+};
+
+class TSteamEngine : public IEngine {
+public:
+    TSteamEngine(EventsType& events) : IEngine{events} {
+        Events_.push_back("TSteamEngine::TSteamEngine()");
+    }
+
+    void Do() override {
+        Events_.push_back("TSteamEngine::Do()");
+    }
+
+    ~TSteamEngine() {
+        Events_.push_back("TSteamEngine::~TSteamEngine()");
+    }
+};
+
+class TJetEngine : public IEngine {
+public:
+    TJetEngine(EventsType& events) : IEngine{events} {
+        Events_.push_back("TJetEngine::TJetEngine()");
+    }
+
+    void Do() override {
+        Events_.push_back("TJetEngine::Do()");
+    }
+
+    ~TJetEngine() {
+        Events_.push_back("TJetEngine::~TJetEngine()");
+    }
+};
+
+} // namespace
+
+TEST(StaticShared, CopiesShareObject) {
+    EventsType events;
+    sp::local_shared_slab<IEngine> slab;
+    {
+        sp::local_shared<IEngine> engine = slab.make<TSteamEngine>(events);
+        EXPECT_EQ(engine.use_count(), 1);
+        {
+            auto copy = engine;
+            EXPECT_EQ(engine.use_count(), 2);
+            EXPECT_EQ(copy.get(), engine.get());
+            EXPECT_TRUE(copy == engine);
+            copy->Do();
+        }
+        EXPECT_EQ(engine.use_count(), 1);
+
+        auto moved = std::move(engine);
+        EXPECT_FALSE(engine);
+        EXPECT_EQ(moved.use_count(), 1);
+        moved->Do();
+    }
+    EXPECT_EQ(slab.size(), 0);
+
+    const EventsType expected{
+        "TSteamEngine::TSteamEngine()",
+        "TSteamEngine::Do()",
+        "TSteamEngine::Do()",
+        "TSteamEngine::~TSteamEngine()",
+    };
+    EXPECT_EQ(events, expected);
+}
+
+TEST(StaticShared, SlotsAreReused) {
+    EventsType events;
+    sp::local_shared_slab<IEngine> slab;
+    std::vector<sp::local_shared<IEngine>> engines;
+    for (int i = 0; i < 10; ++i) {
+        engines.push_back(slab.make<TJetEngine>(events));
+    }
+    EXPECT_EQ(slab.size(), 10);
+    const auto capacity = slab.capacity();
+
+    engines.clear();
+    EXPECT_EQ(slab.size(), 0);
+    for (int i = 0; i < 10; ++i) {
+        engines.push_back(slab.make<TSteamEngine>(events));
+    }
+    EXPECT_EQ(slab.capacity(), capacity);
+}
+
+TEST(StaticShared, WeakHandles) {
+    EventsType events;
+    sp::local_shared_slab<IEngine> slab;
+    sp::local_weak<IEngine> weak;
+    {
+        auto engine = slab.make<TSteamEngine>(events);
+        weak = engine;
+        EXPECT_FALSE(weak.expired());
+        auto locked = weak.lock();
+        EXPECT_EQ(locked.get(), engine.get());
+        EXPECT_EQ(engine.use_count(), 2);
+    }
+    // the object is destructed, but the slot is held by the weak handle
+    EXPECT_TRUE(weak.expired());
+    EXPECT_FALSE(weak.lock());
+    EXPECT_EQ(events.back(), "TSteamEngine::~TSteamEngine()");
+    EXPECT_EQ(slab.size(), 1);
+
+    weak.reset();
+    EXPECT_EQ(slab.size(), 0);
+}
+
+TEST(StaticShared, AtomicCounters) {
+    EventsType events;
+    sp::shared_slab<IEngine> slab;
+    sp::static_shared<IEngine> engine = slab.make<TSteamEngine>(events);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&engine] {
+            for (int j = 0; j < 10000; ++j) {
+                sp::static_shared<IEngine> copy = engine;
+                sp::static_weak<IEngine> weak = copy;
+                EXPECT_TRUE(weak.lock());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(engine.use_count(), 1);
+
+    engine.reset();
+    EXPECT_EQ(slab.size(), 0);
+    EXPECT_EQ(events.back(), "TSteamEngine::~TSteamEngine()");
+}
@@ -0,0 +1,130 @@
+#include "threaded_program.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+struct TStack {
+    std::vector<int> Values;
+
+    int Pop() {
+        const int value = Values.back();
+        Values.pop_back();
+        return value;
+    }
+};
+
+class IOp {
+public:
+    virtual ~IOp() = default;
+    virtual void eval(TStack& stack) const = 0;
+};
+
+class TPush : public IOp {
+public:
+    TPush(int value) : Value_{value} {}
+    void eval(TStack& stack) const override { stack.Values.push_back(Value_); }
+
+private:
+    int Value_;
+};
+
+class TAdd : public IOp {
+public:
+    void eval(TStack& stack) const override { stack.Values.push_back(stack.Pop() + stack.Pop()); }
+};
+
+class TMul : public IOp {
+public:
+    void eval(TStack& stack) const override { stack.Values.push_back(stack.Pop() * stack.Pop()); }
+};
+
+// never registered, runs through the virtual call
+class TNegate : public IOp {
+public:
+    void eval(TStack& stack) const override { stack.Values.back() = -stack.Values.back(); }
+};
+
+using TOps = std::vector<sp::static_ptr<IOp>>;
+using TCompiler = sp::threaded_compiler<IOp, TStack>;
+
+// (1 + 2) * 3, negated, + 4
+TOps MakeOps() {
+    TOps ops;
+    ops.emplace_back().emplace<TPush>(1);
+    ops.emplace_back().emplace<TPush>(2);
+    ops.emplace_back().emplace<TAdd>();
+    ops.emplace_back();
+    ops.emplace_back().emplace<TPush>(3);
+    ops.emplace_back().emplace<TMul>();
+    ops.emplace_back().emplace<TNegate>();
+    ops.emplace_back().emplace<TPush>(4);
+    ops.emplace_back().emplace<TAdd>();
+    return ops;
+}
+
+int Interpret(const TOps& ops) {
+    TStack stack;
+    for (const auto& op : ops) {
+        if (op) {
+            op->eval(stack);
+        }
+    }
+    return stack.Pop();
+}
+
+TEST(ThreadedProgram, SameResult) {
+    const int expected = Interpret(MakeOps());
+    EXPECT_EQ(expected, -5);
+
+    TCompiler compiler;
+    compiler.register_op<TPush>();
+    compiler.register_op<TAdd>();
+    compiler.register_op<TMul>();
+    const auto program = compiler.compile(MakeOps());
+    EXPECT_EQ(program.instruction_count(), 9);
+    EXPECT_EQ(program.size(), 8);
+    EXPECT_EQ(program.fused(), 0);
+
+    TStack stack;
+    program.run(stack);
+    EXPECT_EQ(stack.Pop(), expected);
+    EXPECT_TRUE(stack.Values.empty());
+
+    // the program runs any number of times
+    program.run(stack);
+    EXPECT_EQ(stack.Pop(), expected);
+}
+
+TEST(ThreadedProgram, Superinstructions) {
+    TCompiler compiler;
+    compiler.register_op<TPush>();
+    compiler.register_pair<TPush, TAdd>();
+    compiler.register_pair<TPush, TMul>();
+    compiler.register_pair<TPush, TPush>();
+    const auto program = compiler.compile(MakeOps());
+
+    // push push | add | push mul | negate | push add
+    EXPECT_EQ(program.fused(), 3);
+    EXPECT_EQ(program.size(), 5);
+
+    TStack stack;
+    program.run(stack);
+    EXPECT_EQ(stack.Pop(), -5);
+}
+
+TEST(ThreadedProgram, Unregistered) {
+    TCompiler compiler;
+    const auto program = compiler.compile(MakeOps());
+    EXPECT_EQ(program.size(), 8);
+
+    TStack stack;
+    program.run(stack);
+    EXPECT_EQ(stack.Pop(), -5);
+
+    const auto empty = compiler.compile({});
+    empty.run(stack);
+    EXPECT_TRUE(stack.Values.empty());
+}
+
+} // namespace
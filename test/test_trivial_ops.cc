@@ -0,0 +1,129 @@
+#include "static_ptr.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+
+namespace {
+
+// no virtual destructor, static_ptr destructs the objects by their own type
+class IValue {
+public:
+    virtual int Get() const = 0;
+
+protected:
+    ~IValue() = default;
+};
+
+class TSmallValue : public IValue {
+public:
+    TSmallValue(int value) : Value_{value} {}
+    int Get() const override { return Value_; }
+
+private:
+    int Value_;
+};
+
+class TBigValue : public IValue {
+public:
+    TBigValue(int value) : Value_{value} {}
+    int Get() const override { return static_cast<int>(Value_); }
+
+private:
+    std::int64_t Value_;
+    std::int64_t Padding_[2] = {};
+};
+
+// counts its moves, unless it's declared trivially relocatable
+struct TCounted {
+    static inline int Moves = 0;
+
+    TCounted(int value) : Value{std::make_unique<int>(value)} {}
+    TCounted(TCounted&& rhs) noexcept : Value{std::move(rhs.Value)} { ++Moves; }
+    TCounted& operator=(TCounted&& rhs) noexcept {
+        Value = std::move(rhs.Value);
+        ++Moves;
+        return *this;
+    }
+
+    std::unique_ptr<int> Value;
+};
+
+struct TRelocatable : TCounted {
+    using TCounted::TCounted;
+};
+
+} // namespace
+
+STATIC_PTR_TRIVIALLY_RELOCATABLE(TRelocatable)
+
+namespace {
+
+TEST(TrivialOps, Flags) {
+    EXPECT_TRUE(sp::_::ops_for<TSmallValue>.trivially_destructible);
+    EXPECT_FALSE(sp::_::ops_for<TSmallValue>.trivially_relocatable);
+
+    EXPECT_TRUE(sp::_::ops_for<int>.trivially_destructible);
+    EXPECT_TRUE(sp::_::ops_for<int>.trivially_relocatable);
+
+    EXPECT_FALSE(sp::_::ops_for<TCounted>.trivially_destructible);
+    EXPECT_FALSE(sp::_::ops_for<TCounted>.trivially_relocatable);
+
+    EXPECT_FALSE(sp::_::ops_for<TRelocatable>.trivially_destructible);
+    EXPECT_TRUE(sp::_::ops_for<TRelocatable>.trivially_relocatable);
+}
+
+TEST(TrivialOps, TriviallyDestructible) {
+    sp::static_ptr<IValue, 32> ptr;
+    ptr.emplace<TSmallValue>(1);
+    EXPECT_EQ(ptr->Get(), 1);
+    ptr.emplace<TBigValue>(2);
+    EXPECT_EQ(ptr->Get(), 2);
+
+    sp::static_ptr<IValue, 32> other;
+    other = std::move(ptr);
+    EXPECT_FALSE(ptr);
+    EXPECT_EQ(other->Get(), 2);
+    other.reset();
+    EXPECT_FALSE(other);
+}
+
+TEST(TrivialOps, RelocationSkipsMoves) {
+    TCounted::Moves = 0;
+
+    sp::static_ptr<TRelocatable> a;
+    a.emplace(1);
+    sp::static_ptr<TRelocatable> b = std::move(a);
+    EXPECT_FALSE(a);
+    EXPECT_EQ(*b->Value, 1);
+
+    // same type in the destination, the old object is destructed
+    a.emplace(2);
+    b = std::move(a);
+    EXPECT_FALSE(a);
+    EXPECT_EQ(*b->Value, 2);
+    EXPECT_EQ(TCounted::Moves, 0);
+
+    sp::static_ptr<TCounted> c;
+    c.emplace(3);
+    sp::static_ptr<TCounted> d = std::move(c);
+    EXPECT_EQ(*d->Value, 3);
+    EXPECT_EQ(TCounted::Moves, 1);
+}
+
+TEST(TrivialOps, RelocationBetweenBufferSizes) {
+    sp::static_ptr<TRelocatable> small;
+    small.emplace(4);
+    sp::static_ptr<TRelocatable, 64> big = std::move(small);
+    EXPECT_EQ(*big->Value, 4);
+    EXPECT_FALSE(small);
+    sp::static_ptr<TRelocatable, 128> bigger;
+    bigger = std::move(big);
+    EXPECT_EQ(*bigger->Value, 4);
+    EXPECT_FALSE(big);
+
+    // the bigger buffer may hold an object which doesn't fit into the smaller one
+    EXPECT_FALSE((std::is_constructible_v<sp::static_ptr<TRelocatable>, sp::static_ptr<TRelocatable, 64>&&>));
+    EXPECT_FALSE((std::is_assignable_v<sp::static_ptr<TRelocatable>&, sp::static_ptr<TRelocatable, 64>&&>));
+}
+
+} // namespace